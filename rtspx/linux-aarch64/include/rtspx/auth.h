@@ -0,0 +1,176 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <strings.h>
+
+namespace rtspx {
+    /// MD5 (RFC 1321) as lower case hex, only used for RTSP Digest authentication
+    static inline std::string md5_hex(const std::string &input) {
+        static const uint32_t K[64] = {
+                0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+                0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+                0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+                0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+                0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+                0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+                0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+                0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+                0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+                0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+                0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+                0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+                0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+                0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+                0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+                0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+        };
+        static const uint8_t S[16] = {7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21};
+
+        std::string msg = input;
+        const uint64_t bits = static_cast<uint64_t>(input.size()) * 8;
+        msg.push_back(static_cast<char>(0x80));
+        while (msg.size() % 64 != 56) msg.push_back('\0');
+        for (int i = 0; i < 8; ++i) msg.push_back(static_cast<char>(bits >> (8 * i)));
+
+        uint32_t h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+        const auto *p = reinterpret_cast<const uint8_t *>(msg.data());
+
+        for (size_t offset = 0; offset < msg.size(); offset += 64) {
+            uint32_t w[16];
+            for (int i = 0; i < 16; ++i) {
+                const uint8_t *q = p + offset + i * 4;
+                w[i] = q[0] | (q[1] << 8) | (q[2] << 16) | (static_cast<uint32_t>(q[3]) << 24);
+            }
+
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+            for (int i = 0; i < 64; ++i) {
+                uint32_t f;
+                int g;
+                if (i < 16) {
+                    f = (b & c) | (~b & d);
+                    g = i;
+                } else if (i < 32) {
+                    f = (d & b) | (~d & c);
+                    g = (5 * i + 1) % 16;
+                } else if (i < 48) {
+                    f = b ^ c ^ d;
+                    g = (3 * i + 5) % 16;
+                } else {
+                    f = c ^ (b | ~d);
+                    g = (7 * i) % 16;
+                }
+                const uint32_t x = a + f + K[i] + w[g];
+                const int s = S[(i / 16) * 4 + i % 4];
+                a = d;
+                d = c;
+                c = b;
+                b += (x << s) | (x >> (32 - s));
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+        }
+
+        static const char *hex = "0123456789abcdef";
+        std::string out;
+        out.reserve(32);
+        for (const uint32_t v: h) {
+            for (int i = 0; i < 4; ++i) {
+                const uint8_t byte = static_cast<uint8_t>(v >> (8 * i));
+                out.push_back(hex[byte >> 4]);
+                out.push_back(hex[byte & 0x0F]);
+            }
+        }
+        return out;
+    }
+
+    static inline std::string base64_encode(const std::string &input) {
+        static const char *table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        out.reserve((input.size() + 2) / 3 * 4);
+        size_t i = 0;
+        for (; i + 2 < input.size(); i += 3) {
+            const uint32_t v = (static_cast<uint8_t>(input[i]) << 16) | (static_cast<uint8_t>(input[i + 1]) << 8) |
+                               static_cast<uint8_t>(input[i + 2]);
+            out.push_back(table[(v >> 18) & 0x3F]);
+            out.push_back(table[(v >> 12) & 0x3F]);
+            out.push_back(table[(v >> 6) & 0x3F]);
+            out.push_back(table[v & 0x3F]);
+        }
+        if (i < input.size()) {
+            uint32_t v = static_cast<uint8_t>(input[i]) << 16;
+            if (i + 1 < input.size()) v |= static_cast<uint8_t>(input[i + 1]) << 8;
+            out.push_back(table[(v >> 18) & 0x3F]);
+            out.push_back(table[(v >> 12) & 0x3F]);
+            out.push_back(i + 1 < input.size() ? table[(v >> 6) & 0x3F] : '=');
+            out.push_back('=');
+        }
+        return out;
+    }
+
+    /// Challenge from a 401 response, Digest preferred over Basic
+    struct RtspAuth {
+        bool digest{false};
+        std::string realm{};
+        std::string nonce{};
+
+        [[nodiscard]] bool empty() const { return realm.empty() && nonce.empty() && !digest; }
+    };
+
+    static inline std::string auth_param(const std::string &value, const char *key) {
+        const std::string prefix = std::string(key) + "=";
+        size_t pos = 0;
+        while ((pos = value.find(prefix, pos)) != std::string::npos) {
+            if (pos == 0 || value[pos - 1] == ' ' || value[pos - 1] == ',') break;
+            pos += prefix.size();
+        }
+        if (pos == std::string::npos) return {};
+
+        pos += prefix.size();
+        if (pos < value.size() && value[pos] == '"') {
+            const size_t end = value.find('"', pos + 1);
+            return value.substr(pos + 1, end == std::string::npos ? std::string::npos : end - pos - 1);
+        }
+        return value.substr(pos, value.find_first_of(", ", pos) - pos);
+    }
+
+    /// Pick the challenge out of all WWW-Authenticate headers
+    static inline bool parse_www_authenticate(
+            const std::vector<std::pair<std::string, std::string> > &headers, RtspAuth &auth
+    ) {
+        bool found = false;
+        for (const auto &kv: headers) {
+            if (strcasecmp(kv.first.c_str(), "WWW-Authenticate") != 0) continue;
+            const std::string &value = kv.second;
+            if (strncasecmp(value.c_str(), "Digest", 6) == 0) {
+                auth.digest = true;
+                auth.realm = auth_param(value, "realm");
+                auth.nonce = auth_param(value, "nonce");
+                return true;
+            }
+            if (strncasecmp(value.c_str(), "Basic", 5) == 0) {
+                auth.digest = false;
+                auth.realm = auth_param(value, "realm");
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    /// Authorization header value for one request
+    static inline std::string build_authorization(
+            const RtspAuth &auth, const std::string &username, const std::string &password,
+            const std::string &method, const std::string &uri
+    ) {
+        if (!auth.digest) return "Basic " + base64_encode(username + ":" + password);
+
+        const std::string ha1 = md5_hex(username + ":" + auth.realm + ":" + password);
+        const std::string ha2 = md5_hex(method + ":" + uri);
+        const std::string response = md5_hex(ha1 + ":" + auth.nonce + ":" + ha2);
+        return "Digest username=\"" + username + "\", realm=\"" + auth.realm + "\", nonce=\"" + auth.nonce +
+               "\", uri=\"" + uri + "\", response=\"" + response + "\"";
+    }
+}
@@ -0,0 +1,463 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "rtspx/sessionx.h"
+#include "rtspx/poller.h"
+#include "rtspx/rtsp_msg.h"
+
+namespace rtspx {
+    /// Load summary one node gossips to its peers
+    struct ClusterLoad {
+        std::string node_id{};
+        std::string rtsp_host{}; // where viewers reach the node's RtspServer
+        uint16_t rtsp_port{554};
+        uint32_t clients{0};
+        uint32_t egress_kbps{0};
+        uint32_t cpu_percent{0};
+        uint32_t load_permille{0}; // highest of clients/egress/cpu against the node's own limits
+        std::vector<std::string> streams{};
+        int64_t seen_ms{0};
+    };
+
+    struct ClusterConfig {
+        std::string node_id{};
+        std::string rtsp_host{"127.0.0.1"};
+        uint16_t rtsp_port{554};
+
+        std::string gossip_ip{}; // bind address, empty = any
+        uint16_t gossip_port{0};
+        std::vector<std::pair<std::string, uint16_t> > peers{}; // gossip addresses of the other nodes
+        uint32_t interval_ms{1000};
+        uint32_t expire_ms{5000}; // peers not heard from in this time are ignored
+
+        // limits, 0 = none. Past a limit new viewers are redirected to a less-loaded peer
+        uint32_t max_clients{0};
+        uint32_t max_egress_kbps{0};
+        uint32_t max_cpu_percent{90};
+    };
+
+    /*
+     * Least-loaded redirect for several RtspServer nodes serving the same streams.
+     *
+     * Every node gossips a ClusterLoad over UDP to its peers. The RTSP entry port (start()) answers
+     * DESCRIBE/SETUP/PLAY with "302 Moved Temporarily" to the node that should serve the stream: this node
+     * while it is below its limits, otherwise the least-loaded live peer that carries the stream. Hand out
+     * the entry url to viewers, the RtspServer itself listens on rtsp_host:rtsp_port.
+     *
+     * Clients are counted from the MediaSessions given to add_stream(), egress comes from the load callback
+     * (the server does not expose its byte counters), CPU from /proc/stat.
+     */
+    class RtspCluster {
+    public:
+        using LoadCallback = std::function<void(ClusterLoad &load)>;
+
+        explicit RtspCluster(const ClusterConfig &config) : config_(config) {
+            if (config_.node_id.empty()) config_.node_id = config_.rtsp_host + ":" + std::to_string(config_.rtsp_port);
+            if (config_.interval_ms == 0) config_.interval_ms = 1000;
+        }
+
+        ~RtspCluster() { stop(); }
+
+        RtspCluster(const RtspCluster &) = delete;
+
+        RtspCluster &operator=(const RtspCluster &) = delete;
+
+        /// Gossip and, with an entry port, the redirecting RTSP listener
+        bool start(const std::string &ip = {}, uint16_t entry_port = 0) {
+            if (gossip_fd_ >= 0) return false;
+
+            gossip_fd_ = open_socket(SOCK_DGRAM, config_.gossip_ip, config_.gossip_port);
+            if (gossip_fd_ < 0) return false;
+            poller_.add(gossip_fd_, EPOLLIN, [this](uint32_t) { on_gossip(); });
+
+            if (entry_port != 0) {
+                listen_fd_ = open_socket(SOCK_STREAM, ip, entry_port);
+                if (listen_fd_ < 0 || ::listen(listen_fd_, SOMAXCONN) != 0) {
+                    stop();
+                    return false;
+                }
+                poller_.add(listen_fd_, EPOLLIN, [this](uint32_t) { on_accept(); });
+            }
+
+            timer_id_ = poller_.add_timer(config_.interval_ms, [this]() {
+                update_local();
+                broadcast();
+                check_timeout();
+                return true;
+            });
+            update_local();
+            return poller_.start();
+        }
+
+        void stop() {
+            poller_.stop();
+            if (timer_id_ != 0) poller_.remove_timer(timer_id_);
+            timer_id_ = 0;
+
+            std::vector<int> fds;
+            for (const auto &kv: clients_) fds.push_back(kv.first);
+            for (const int fd: fds) close_client(fd);
+
+            for (int *fd: {&listen_fd_, &gossip_fd_}) {
+                if (*fd < 0) continue;
+                poller_.remove(*fd);
+                ::close(*fd);
+                *fd = -1;
+            }
+        }
+
+        /// Stream served by this node, clients of the session count towards its load
+        void add_stream(const std::string &suffix, const std::shared_ptr<MediaSession> &session = nullptr) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            streams_[suffix] = session;
+        }
+
+        void remove_stream(const std::string &suffix) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            streams_.erase(suffix);
+        }
+
+        /// Fill in what the node cannot measure itself (egress, clients of other servers), runs on the loop thread
+        void set_load_callback(LoadCallback cb) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            load_cb_ = std::move(cb);
+        }
+
+        /// Url the viewer of suffix should use, empty when the stream is unknown to the cluster
+        std::string pick(const std::string &suffix) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const bool local = streams_.count(suffix) != 0;
+            if (local && local_.load_permille < 1000) return url(local_, suffix);
+
+            const int64_t deadline = net::now_ms() - static_cast<int64_t>(config_.expire_ms);
+            const ClusterLoad *best = nullptr;
+            for (const auto &kv: peers_) {
+                const ClusterLoad &peer = kv.second;
+                if (peer.seen_ms < deadline || peer.load_permille >= 1000) continue;
+                if (std::find(peer.streams.begin(), peer.streams.end(), suffix) == peer.streams.end()) continue;
+                if (best == nullptr || peer.load_permille < best->load_permille) best = &peer;
+            }
+            if (best != nullptr) return url(*best, suffix);
+            return local ? url(local_, suffix) : std::string(); // everyone is full, serve anyway
+        }
+
+        [[nodiscard]] ClusterLoad local_load() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return local_;
+        }
+
+        [[nodiscard]] std::vector<ClusterLoad> peers() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<ClusterLoad> out;
+            for (const auto &kv: peers_) out.push_back(kv.second);
+            return out;
+        }
+
+        [[nodiscard]] uint64_t num_redirects() const { return num_redirects_.load(); }
+
+        /// Serialized summary, "key=value" lines
+        static std::string encode(const ClusterLoad &load) {
+            std::string out = "rtspx-load 1\n";
+            out += "node=" + load.node_id + "\n";
+            out += "host=" + load.rtsp_host + "\n";
+            out += "port=" + std::to_string(load.rtsp_port) + "\n";
+            out += "clients=" + std::to_string(load.clients) + "\n";
+            out += "egress=" + std::to_string(load.egress_kbps) + "\n";
+            out += "cpu=" + std::to_string(load.cpu_percent) + "\n";
+            out += "load=" + std::to_string(load.load_permille) + "\n";
+            for (const auto &stream: load.streams) out += "stream=" + stream + "\n";
+            return out;
+        }
+
+        static bool decode(const std::string &data, ClusterLoad &load) {
+            if (data.compare(0, 13, "rtspx-load 1\n") != 0) return false;
+            load = ClusterLoad();
+            size_t pos = 13;
+            while (pos < data.size()) {
+                size_t eol = data.find('\n', pos);
+                if (eol == std::string::npos) eol = data.size();
+                const size_t eq = data.find('=', pos);
+                if (eq < eol) {
+                    const std::string key = data.substr(pos, eq - pos);
+                    const std::string value = data.substr(eq + 1, eol - eq - 1);
+                    const auto number = static_cast<uint32_t>(std::strtoul(value.c_str(), nullptr, 10));
+                    if (key == "node") load.node_id = value;
+                    if (key == "host") load.rtsp_host = value;
+                    if (key == "port") load.rtsp_port = static_cast<uint16_t>(number);
+                    if (key == "clients") load.clients = number;
+                    if (key == "egress") load.egress_kbps = number;
+                    if (key == "cpu") load.cpu_percent = number;
+                    if (key == "load") load.load_permille = number;
+                    if (key == "stream") load.streams.push_back(value);
+                }
+                pos = eol + 1;
+            }
+            return !load.node_id.empty() && !load.rtsp_host.empty();
+        }
+
+    private:
+        static constexpr size_t MAX_REQUEST_SIZE = 16 * 1024;
+        static constexpr int64_t CLIENT_TIMEOUT_MS = 10000;
+
+        struct Client {
+            std::string in;
+            std::string out;
+            int64_t active_ms{0};
+        };
+
+        static int open_socket(int type, const std::string &ip, uint16_t port) {
+            const int fd = ::socket(AF_INET, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) return -1;
+
+            const int on = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = ip.empty() ? INADDR_ANY : ::inet_addr(ip.c_str());
+            if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+                ::close(fd);
+                return -1;
+            }
+            return fd;
+        }
+
+        static std::string url(const ClusterLoad &load, const std::string &suffix) {
+            return "rtsp://" + load.rtsp_host + ":" + std::to_string(load.rtsp_port) + "/" + suffix;
+        }
+
+        void update_local() {
+            ClusterLoad load;
+            load.node_id = config_.node_id;
+            load.rtsp_host = config_.rtsp_host;
+            load.rtsp_port = config_.rtsp_port;
+            load.cpu_percent = cpu_percent();
+
+            LoadCallback cb;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (const auto &kv: streams_) {
+                    load.streams.push_back(kv.first);
+                    if (kv.second) load.clients += kv.second->get_num_client();
+                }
+                cb = load_cb_;
+            }
+            if (cb) cb(load);
+
+            uint32_t permille = 0;
+            auto limit = [&permille](uint32_t value, uint32_t max) {
+                if (max != 0) permille = std::max(permille, static_cast<uint32_t>(uint64_t(value) * 1000 / max));
+            };
+            limit(load.clients, config_.max_clients);
+            limit(load.egress_kbps, config_.max_egress_kbps);
+            limit(load.cpu_percent, config_.max_cpu_percent);
+            load.load_permille = permille;
+            load.seen_ms = net::now_ms();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            local_ = std::move(load);
+        }
+
+        /// Busy share of all CPUs since the previous call
+        uint32_t cpu_percent() {
+            FILE *fp = std::fopen("/proc/stat", "r");
+            if (fp == nullptr) return 0;
+            unsigned long long v[8] = {};
+            const int n = std::fscanf(fp, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+                                      &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+            std::fclose(fp);
+            if (n < 4) return 0;
+
+            const uint64_t idle = v[3] + v[4]; // idle + iowait
+            uint64_t total = 0;
+            for (const auto x: v) total += x;
+
+            const uint64_t d_total = total - cpu_total_, d_idle = idle - cpu_idle_;
+            const bool first = cpu_total_ == 0;
+            cpu_total_ = total;
+            cpu_idle_ = idle;
+            if (first || d_total == 0) return 0;
+            return static_cast<uint32_t>((d_total - std::min(d_idle, d_total)) * 100 / d_total);
+        }
+
+        void broadcast() {
+            std::string data;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                data = encode(local_);
+            }
+            for (const auto &peer: config_.peers) {
+                sockaddr_in addr{};
+                addr.sin_family = AF_INET;
+                addr.sin_port = htons(peer.second);
+                addr.sin_addr.s_addr = ::inet_addr(peer.first.c_str());
+                ::sendto(gossip_fd_, data.data(), data.size(), MSG_NOSIGNAL, reinterpret_cast<sockaddr *>(&addr),
+                         sizeof(addr));
+            }
+        }
+
+        void on_gossip() {
+            char buf[64 * 1024];
+            ssize_t n;
+            while ((n = ::recv(gossip_fd_, buf, sizeof(buf), 0)) > 0) {
+                ClusterLoad load;
+                if (!decode(std::string(buf, static_cast<size_t>(n)), load) || load.node_id == config_.node_id) {
+                    continue;
+                }
+                load.seen_ms = net::now_ms();
+                std::lock_guard<std::mutex> lock(mutex_);
+                peers_[load.node_id] = std::move(load);
+            }
+        }
+
+        void on_accept() {
+            while (true) {
+                const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) return;
+
+                const int on = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+                clients_[fd].active_ms = net::now_ms();
+                poller_.add(fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, [this, fd](uint32_t events) {
+                    on_event(fd, events);
+                });
+            }
+        }
+
+        void on_event(int fd, uint32_t events) {
+            const auto it = clients_.find(fd);
+            if (it == clients_.end()) return;
+            Client &client = it->second;
+
+            if (events & (EPOLLERR | EPOLLHUP)) {
+                close_client(fd);
+                return;
+            }
+
+            if (events & (EPOLLIN | EPOLLRDHUP)) {
+                char buf[4096];
+                while (true) {
+                    const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+                    if (n > 0) {
+                        client.in.append(buf, n);
+                        continue;
+                    }
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                    if (n < 0 && errno == EINTR) continue;
+                    close_client(fd);
+                    return;
+                }
+                client.active_ms = net::now_ms();
+
+                bool closed = false;
+                const long consumed = consume_rtsp_stream(
+                        client.in.data(), client.in.size(),
+                        [](uint8_t, const uint8_t *, size_t) { return true; },
+                        [this, &client, &closed](const RtspMsg &msg) {
+                            if (!msg.response) closed = !handle_request(client, msg);
+                            return !closed;
+                        }
+                );
+                if (consumed < 0 || closed || client.in.size() - static_cast<size_t>(consumed) > MAX_REQUEST_SIZE) {
+                    flush(fd, client);
+                    close_client(fd);
+                    return;
+                }
+                client.in.erase(0, consumed);
+            }
+
+            if (!flush(fd, client)) close_client(fd);
+        }
+
+        /// false closes the connection once the reply is out
+        bool handle_request(Client &client, const RtspMsg &msg) {
+            const int cseq = msg.cseq();
+            if (msg.method == "OPTIONS") {
+                client.out += build_rtsp_response(200, "OK", cseq, {
+                        {"Public", "OPTIONS, DESCRIBE, SETUP, PLAY, TEARDOWN"}
+                });
+                return true;
+            }
+            if (msg.method == "TEARDOWN") {
+                client.out += build_rtsp_response(200, "OK", cseq);
+                return false;
+            }
+
+            const std::string target = pick(rtsp_url_suffix(msg.url));
+            if (target.empty()) {
+                client.out += build_rtsp_response(404, "Not Found", cseq);
+                return true;
+            }
+            client.out += build_rtsp_response(302, "Moved Temporarily", cseq, {{"Location", target}});
+            ++num_redirects_;
+            return true;
+        }
+
+        static bool flush(int fd, Client &client) {
+            while (!client.out.empty()) {
+                const ssize_t n = ::send(fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+                if (n > 0) {
+                    client.out.erase(0, n);
+                    continue;
+                }
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true; // EPOLLOUT edge resumes
+                if (n < 0 && errno == EINTR) continue;
+                return false;
+            }
+            return true;
+        }
+
+        void close_client(int fd) {
+            if (clients_.erase(fd) == 0) return;
+            poller_.remove(fd);
+            ::close(fd);
+        }
+
+        void check_timeout() {
+            const int64_t deadline = net::now_ms() - CLIENT_TIMEOUT_MS;
+            std::vector<int> expired;
+            for (const auto &kv: clients_) {
+                if (kv.second.active_ms < deadline) expired.push_back(kv.first);
+            }
+            for (const int fd: expired) close_client(fd);
+        }
+
+    private:
+        ClusterConfig config_;
+
+        int gossip_fd_{-1};
+        int listen_fd_{-1};
+        uint32_t timer_id_{0};
+        net::Poller poller_;
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, std::shared_ptr<MediaSession> > streams_;
+        std::unordered_map<std::string, ClusterLoad> peers_;
+        ClusterLoad local_;
+        LoadCallback load_cb_;
+
+        uint64_t cpu_total_{0};
+        uint64_t cpu_idle_{0};
+
+        std::unordered_map<int, Client> clients_;
+        std::atomic<uint64_t> num_redirects_{0};
+    };
+}
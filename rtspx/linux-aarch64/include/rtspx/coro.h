@@ -0,0 +1,800 @@
+#pragma once
+
+#include <new>
+#include <cerrno>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <utility>
+#include <optional>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define RTSPX_HAS_COROUTINES 1
+#else
+#define RTSPX_HAS_COROUTINES 0
+#endif
+
+#include "rtspx/sdp.h"
+#include "rtspx/auth.h"
+#include "rtspx/poller.h"
+#include "rtspx/rtsp_msg.h"
+#include "rtspx/depacketizer.h"
+#include "rtspx/mirror_buffer.h"
+
+#if RTSPX_HAS_COROUTINES
+
+namespace rtspx::net {
+    /*
+     * Per-thread free lists of coroutine frames in power-of-two size classes (256 B .. 32 KB).
+     * A frame released on another thread goes to that thread's list, larger frames use plain new/delete.
+     */
+    class CoFramePool {
+    public:
+        static void *allocate(size_t size) {
+            const size_t index = size_class(size + HEADER_SIZE);
+            void *block = nullptr;
+            if (index < NUM_CLASSES) {
+                FreeList &list = lists()[index];
+                block = list.head;
+                if (block != nullptr) {
+                    list.head = *static_cast<void **>(block);
+                    --list.count;
+                } else {
+                    block = ::operator new(MIN_SIZE << index);
+                }
+            } else {
+                block = ::operator new(size + HEADER_SIZE);
+            }
+            *static_cast<size_t *>(block) = index;
+            return static_cast<unsigned char *>(block) + HEADER_SIZE;
+        }
+
+        static void release(void *frame) {
+            if (frame == nullptr) return;
+            void *block = static_cast<unsigned char *>(frame) - HEADER_SIZE;
+            const size_t index = *static_cast<size_t *>(block);
+            if (index < NUM_CLASSES) {
+                FreeList &list = lists()[index];
+                if (list.count < MAX_CACHED) {
+                    *static_cast<void **>(block) = list.head;
+                    list.head = block;
+                    ++list.count;
+                    return;
+                }
+            }
+            ::operator delete(block);
+        }
+
+    private:
+        static constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+        static constexpr size_t MIN_SIZE = 256;
+        static constexpr size_t NUM_CLASSES = 8;
+        static constexpr size_t MAX_CACHED = 256; // per class and thread
+
+        struct FreeList {
+            void *head{nullptr};
+            size_t count{0};
+
+            ~FreeList() {
+                while (head != nullptr) {
+                    void *next = *static_cast<void **>(head);
+                    ::operator delete(head);
+                    head = next;
+                }
+            }
+        };
+
+        static size_t size_class(size_t size) {
+            size_t index = 0;
+            while (index < NUM_CLASSES && (MIN_SIZE << index) < size) ++index;
+            return index;
+        }
+
+        static FreeList *lists() {
+            static thread_local FreeList lists[NUM_CLASSES];
+            return lists;
+        }
+    };
+
+    struct CoPromiseBase {
+        std::coroutine_handle<> continuation{};
+        std::exception_ptr exception{};
+        bool detached{false};
+
+        static void *operator new(size_t size) { return CoFramePool::allocate(size); }
+
+        static void operator delete(void *frame) { CoFramePool::release(frame); }
+
+        struct FinalAwaiter {
+            [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+            template<typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                CoPromiseBase &promise = handle.promise();
+                if (promise.detached) {
+                    if (promise.exception) std::terminate(); // nobody is left to rethrow to
+                    handle.destroy();
+                    return std::noop_coroutine();
+                }
+                return promise.continuation ? promise.continuation : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    template<typename T>
+    class CoTask;
+
+    template<typename T>
+    struct CoPromise : CoPromiseBase {
+        std::optional<T> value{};
+
+        CoTask<T> get_return_object();
+
+        template<typename U>
+        void return_value(U &&v) { value.emplace(std::forward<U>(v)); }
+    };
+
+    template<>
+    struct CoPromise<void> : CoPromiseBase {
+        CoTask<void> get_return_object();
+
+        void return_void() {}
+    };
+
+    /*
+     * Lazy coroutine task: the body starts when the task is awaited and the awaiting coroutine resumes by
+     * symmetric transfer when it finishes, so chains of awaited tasks do not grow the stack.
+     * Frames come from CoFramePool. A task that is never awaited has to be handed to co_spawn().
+     */
+    template<typename T = void>
+    class CoTask {
+    public:
+        using promise_type = CoPromise<T>;
+        using Handle = std::coroutine_handle<promise_type>;
+
+        CoTask() = default;
+
+        explicit CoTask(Handle handle) : handle_(handle) {}
+
+        CoTask(CoTask &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+        CoTask &operator=(CoTask &&other) noexcept {
+            if (this != &other) {
+                if (handle_) handle_.destroy();
+                handle_ = std::exchange(other.handle_, {});
+            }
+            return *this;
+        }
+
+        ~CoTask() {
+            if (handle_) handle_.destroy();
+        }
+
+        CoTask(const CoTask &) = delete;
+
+        CoTask &operator=(const CoTask &) = delete;
+
+        [[nodiscard]] bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+            handle_.promise().continuation = caller;
+            return handle_;
+        }
+
+        T await_resume() {
+            if (!handle_) { // default-constructed or released, there is no body and no result
+                if constexpr (std::is_void_v<T>) return;
+                else throw std::logic_error("co_await on an empty CoTask");
+            }
+            promise_type &promise = handle_.promise();
+            if (promise.exception) std::rethrow_exception(promise.exception);
+            if constexpr (!std::is_void_v<T>) return std::move(*promise.value);
+        }
+
+        /// Give up ownership, used by co_spawn
+        Handle release() { return std::exchange(handle_, {}); }
+
+    private:
+        Handle handle_{};
+    };
+
+    template<typename T>
+    CoTask<T> CoPromise<T>::get_return_object() { return CoTask<T>(CoTask<T>::Handle::from_promise(*this)); }
+
+    inline CoTask<void> CoPromise<void>::get_return_object() {
+        return CoTask<void>(CoTask<void>::Handle::from_promise(*this));
+    }
+
+    /// Run a task detached on the poller thread, its frame is freed when the body returns
+    static inline void co_spawn(Poller &poller, CoTask<void> task) {
+        auto handle = task.release();
+        if (!handle) return;
+        handle.promise().detached = true;
+        poller.post([handle]() { handle.resume(); });
+    }
+
+    class CoSleepAwaiter {
+    public:
+        CoSleepAwaiter(Poller &poller, uint32_t ms) : poller_(poller), ms_(ms) {}
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            poller_.add_timer(ms_, [handle]() {
+                handle.resume();
+                return false;
+            });
+        }
+
+        void await_resume() const noexcept {}
+
+    private:
+        Poller &poller_;
+        uint32_t ms_;
+    };
+
+    class CoResumeAwaiter {
+    public:
+        explicit CoResumeAwaiter(Poller &poller) : poller_(poller) {}
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) { poller_.post([handle]() { handle.resume(); }); }
+
+        void await_resume() const noexcept {}
+
+    private:
+        Poller &poller_;
+    };
+
+    /// co_await co_sleep(poller, ms) resumes on the poller thread after ms
+    static inline CoSleepAwaiter co_sleep(Poller &poller, uint32_t ms) { return {poller, ms}; }
+
+    /// co_await co_resume_on(poller) continues on the poller thread, e.g. at the top of a task started elsewhere
+    static inline CoResumeAwaiter co_resume_on(Poller &poller) { return CoResumeAwaiter(poller); }
+
+    /*
+     * Edge-triggered TCP socket for coroutines running on a Poller. The socket is its own PollHandler and one
+     * timer per connection checks the deadlines, so waiting for data allocates nothing besides pooled frames.
+     *
+     * At most one coroutine waits for reading and one for writing at a time, and the socket must outlive them.
+     * Use it from the poller thread only.
+     */
+    class CoSocket : public PollHandler {
+    public:
+        explicit CoSocket(Poller &poller) : poller_(poller) {}
+
+        ~CoSocket() override { close(); }
+
+        CoSocket(const CoSocket &) = delete;
+
+        CoSocket &operator=(const CoSocket &) = delete;
+
+        /// False on error or when the connection is not up within timeout_ms
+        CoTask<bool> connect(sockaddr_in addr, uint32_t timeout_ms) {
+            close();
+            fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd_ < 0) co_return false;
+
+            const int on = 1;
+            ::setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+            const bool pending = ::connect(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0;
+            if ((pending && errno != EINPROGRESS) || !attach()) {
+                close();
+                co_return false;
+            }
+            if (!pending) co_return true;
+
+            writable_ = false;
+            if (!co_await Waiter{*this, true, deadline(timeout_ms)}) {
+                close();
+                co_return false;
+            }
+            int error = 0;
+            socklen_t len = sizeof(error);
+            ::getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &len);
+            if (error != 0) close();
+            co_return error == 0;
+        }
+
+        /// Read what is available into in(). Returns the bytes read, 0 at end of stream, -1 on error (ETIMEDOUT)
+        CoTask<ssize_t> read_some(uint32_t timeout_ms) {
+            while (fd_ >= 0) {
+                const ssize_t n = in_.read_fd(fd_);
+                if (n >= 0) co_return n;
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) co_return -1;
+                readable_ = false;
+                if (!co_await Waiter{*this, false, deadline(timeout_ms)}) {
+                    if (fd_ >= 0) errno = ETIMEDOUT;
+                    co_return -1;
+                }
+            }
+            co_return -1;
+        }
+
+        /// Queue data and send what the socket takes now, false when the connection failed
+        bool write(const char *data, size_t size) {
+            if (fd_ < 0) return false;
+            out_.append(data, size);
+            return flush();
+        }
+
+        /// Wait until everything queued is sent
+        CoTask<bool> drain(uint32_t timeout_ms) {
+            while (fd_ >= 0 && !out_.empty()) {
+                const bool writable = co_await Waiter{*this, true, deadline(timeout_ms)};
+                if (!writable || !flush()) co_return false;
+            }
+            co_return fd_ >= 0;
+        }
+
+        CoTask<bool> send(std::string data, uint32_t timeout_ms) {
+            if (!write(data.data(), data.size())) co_return false;
+            co_return co_await drain(timeout_ms);
+        }
+
+        /// Waiting coroutines resume (and fail) on the next loop iteration
+        void close() {
+            if (fd_ < 0) return;
+            if (timer_id_ != 0) poller_.remove_timer(timer_id_);
+            poller_.remove(fd_);
+            ::close(fd_);
+            fd_ = -1;
+            timer_id_ = 0;
+            in_.clear();
+            out_.clear();
+            readable_ = writable_ = false;
+
+            for (auto *waiter: {&reader_, &writer_}) {
+                if (!*waiter) continue;
+                std::coroutine_handle<> handle = std::exchange(*waiter, {});
+                poller_.post([handle]() { handle.resume(); });
+            }
+        }
+
+        [[nodiscard]] bool is_open() const { return fd_ >= 0; }
+
+        [[nodiscard]] int fd() const { return fd_; }
+
+        /// Received bytes, parse in place and consume()
+        MirrorBuffer &in() { return in_; }
+
+        /// Bytes queued but not sent yet
+        [[nodiscard]] size_t backlog() const { return out_.size(); }
+
+        void on_poll_events(uint32_t events) override {
+            if (events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) readable_ = true;
+            if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) writable_ = true;
+            std::coroutine_handle<> reader = readable_ ? std::exchange(reader_, {}) : nullptr;
+            std::coroutine_handle<> writer = writable_ ? std::exchange(writer_, {}) : nullptr;
+            // the resumed coroutine may close or destroy the socket, do not touch members afterwards
+            if (reader) reader.resume();
+            if (writer) writer.resume();
+        }
+
+    private:
+        struct Waiter {
+            CoSocket &socket;
+            bool write;
+            int64_t deadline_ms;
+
+            [[nodiscard]] bool await_ready() const noexcept { return socket.fd_ < 0 || ready(); }
+
+            void await_suspend(std::coroutine_handle<> handle) noexcept {
+                (write ? socket.writer_ : socket.reader_) = handle;
+                (write ? socket.write_deadline_ms_ : socket.read_deadline_ms_) = deadline_ms;
+            }
+
+            /// False on timeout or close
+            [[nodiscard]] bool await_resume() const noexcept { return socket.fd_ >= 0 && ready(); }
+
+            [[nodiscard]] bool ready() const { return write ? socket.writable_ : socket.readable_; }
+        };
+
+        static int64_t deadline(uint32_t timeout_ms) { return now_ms() + timeout_ms; }
+
+        bool attach() {
+            if (!poller_.add(fd_, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, this)) return false;
+            timer_id_ = poller_.add_timer(TIMER_INTERVAL_MS, [this]() {
+                on_timer();
+                return true;
+            });
+            return true;
+        }
+
+        void on_timer() {
+            const int64_t now = now_ms();
+            std::coroutine_handle<> reader = now >= read_deadline_ms_ ? std::exchange(reader_, {}) : nullptr;
+            std::coroutine_handle<> writer = now >= write_deadline_ms_ ? std::exchange(writer_, {}) : nullptr;
+            if (reader) reader.resume();
+            if (writer) writer.resume();
+        }
+
+        bool flush() {
+            while (!out_.empty()) {
+                const ssize_t n = ::send(fd_, out_.data(), out_.size(), MSG_NOSIGNAL);
+                if (n > 0) {
+                    out_.erase(0, n);
+                    continue;
+                }
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    writable_ = false;
+                    return true;
+                }
+                if (n < 0 && errno == EINTR) continue;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        static constexpr uint32_t TIMER_INTERVAL_MS = 50;
+
+        Poller &poller_;
+        int fd_{-1};
+        uint32_t timer_id_{0};
+        MirrorBuffer in_;
+        std::string out_;
+
+        bool readable_{false};
+        bool writable_{false};
+        std::coroutine_handle<> reader_{};
+        std::coroutine_handle<> writer_{};
+        int64_t read_deadline_ms_{0};
+        int64_t write_deadline_ms_{0};
+    };
+}
+
+namespace rtspx {
+    struct CoRtspConfig {
+        uint32_t timeout_ms{10000}; // connect and response timeout
+        std::string user_agent{"rtspx"};
+    };
+
+    /// Parse the url and resolve its host (getaddrinfo, blocking) into addr with the url port
+    static inline bool resolve_rtsp_url(const std::string &url, RtspUrl &parsed, sockaddr_in &addr) {
+        if (!parse_rtsp_url(url, parsed)) return false;
+        addr = sockaddr_in{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(parsed.port);
+        if (::inet_pton(AF_INET, parsed.host.c_str(), &addr.sin_addr) == 1) return true;
+
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *result = nullptr;
+        if (::getaddrinfo(parsed.host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) return false;
+        addr.sin_addr = reinterpret_cast<sockaddr_in *>(result->ai_addr)->sin_addr;
+        ::freeaddrinfo(result);
+        return true;
+    }
+
+    /*
+     * RTSP over TCP for coroutines: request() sends one request and returns its response, answering 401
+     * challenges with the url credentials and keeping CSeq/Session. Interleaved data that arrives in between
+     * goes to the interleaved callback. The handshakes below (rtsp_play, rtsp_record) are plain sequences of
+     * co_await on top of it, RtspClient (client.h) runs a pull session with them.
+     */
+    class CoRtspConnection {
+    public:
+        using Headers = std::vector<std::pair<std::string, std::string> >;
+        using InterleavedCallback = std::function<void(uint8_t channel, const uint8_t *data, size_t size)>;
+
+        explicit CoRtspConnection(net::Poller &poller, CoRtspConfig config = {})
+                : socket_(poller), config_(std::move(config)) {}
+
+        ~CoRtspConnection() { close(); }
+
+        CoRtspConnection(const CoRtspConnection &) = delete;
+
+        CoRtspConnection &operator=(const CoRtspConnection &) = delete;
+
+        void set_interleaved_callback(InterleavedCallback cb) { interleaved_cb_ = std::move(cb); }
+
+        /// Connect to the url host. Host names are resolved with getaddrinfo, which blocks the poller thread
+        net::CoTask<bool> connect(const std::string &url) {
+            RtspUrl parsed;
+            sockaddr_in addr{};
+            if (!resolve_rtsp_url(url, parsed, addr)) {
+                close();
+                error_ = "invalid url";
+                co_return false;
+            }
+            co_return co_await connect(url, addr);
+        }
+
+        /// Connect to an address resolved beforehand (resolve_rtsp_url), the url gives path and credentials
+        net::CoTask<bool> connect(const std::string &url, sockaddr_in addr) {
+            close();
+            error_.clear();
+            if (!parse_rtsp_url(url, parsed_)) {
+                error_ = "invalid url";
+                co_return false;
+            }
+            addr.sin_port = htons(parsed_.port);
+
+            // credentials never go on the wire inside the url
+            url_ = "rtsp://" + parsed_.host + ":" + std::to_string(parsed_.port) + "/" + parsed_.path;
+            const bool connected = co_await socket_.connect(addr, config_.timeout_ms);
+            if (!connected) error_ = "connect failed";
+            co_return connected;
+        }
+
+        /*
+         * Send a request and wait for its response, status 0 when the connection failed or timed out.
+         * GCC 12 rejects a braced header list inside a co_await expression, declare the Headers first.
+         */
+        net::CoTask<RtspMsg> request(std::string method, std::string url, Headers headers = {},
+                                     std::string body = {}) {
+            for (int attempt = 0; attempt < 2; ++attempt) {
+                const int cseq = ++cseq_;
+                Headers all = headers;
+                all.emplace_back("User-Agent", config_.user_agent);
+                if (!session_.empty()) all.emplace_back("Session", session_);
+                if (!auth_.empty()) {
+                    all.emplace_back("Authorization", build_authorization(
+                            auth_, parsed_.username, parsed_.password, method, url
+                    ));
+                }
+
+                if (!co_await socket_.send(build_rtsp_request(method.c_str(), url, cseq, all, body),
+                                           config_.timeout_ms)) {
+                    error_ = method + " send failed";
+                    co_return RtspMsg{};
+                }
+
+                RtspMsg response;
+                while (!take_input(cseq, &response)) {
+                    if (co_await socket_.read_some(config_.timeout_ms) <= 0) {
+                        error_ = method + (socket_.is_open() ? " timeout" : " connection closed");
+                        co_return RtspMsg{};
+                    }
+                }
+
+                if (response.status == 401 && attempt == 0 && !parsed_.username.empty() &&
+                    parse_www_authenticate(response.headers, auth_)) {
+                    continue;
+                }
+                if (response.status == 200) {
+                    if (session_.empty()) take_session(response);
+                    if (method == "OPTIONS") public_ = response.header("Public");
+                } else {
+                    error_ = method + " " + std::to_string(response.status) + " " + response.reason;
+                }
+                co_return response;
+            }
+            co_return RtspMsg{};
+        }
+
+        /// Wait up to timeout_ms for input and dispatch it, false when the connection is gone or broken
+        net::CoTask<bool> pump(uint32_t timeout_ms) {
+            const ssize_t n = co_await socket_.read_some(timeout_ms);
+            if (n > 0) {
+                take_input(-1, nullptr);
+            } else if (n == 0 || errno != ETIMEDOUT) {
+                close();
+            }
+            co_return socket_.is_open();
+        }
+
+        /// Queue one interleaved frame ('$' channel length payload), false when the connection failed
+        bool send_interleaved(uint8_t channel, const uint8_t *data, size_t size) {
+            if (size > 0xFFFF) return false;
+            const char head[4] = {'$', static_cast<char>(channel), static_cast<char>(size >> 8),
+                                  static_cast<char>(size & 0xFF)};
+            return socket_.write(head, sizeof(head)) && socket_.write(reinterpret_cast<const char *>(data), size);
+        }
+
+        /// Best effort TEARDOWN when a session is up, then close the socket
+        void close() {
+            if (socket_.is_open() && !session_.empty()) {
+                const std::string teardown = build_rtsp_request("TEARDOWN", url_, ++cseq_, {
+                        {"User-Agent", config_.user_agent},
+                        {"Session",    session_}
+                });
+                socket_.write(teardown.data(), teardown.size());
+            }
+            socket_.close();
+            cseq_ = 0;
+            auth_ = RtspAuth();
+            session_.clear();
+            session_timeout_s_ = 60;
+            public_.clear();
+        }
+
+        [[nodiscard]] bool is_open() const { return socket_.is_open(); }
+
+        /// Request url of the connected stream, without credentials
+        [[nodiscard]] const std::string &url() const { return url_; }
+
+        [[nodiscard]] const std::string &session() const { return session_; }
+
+        [[nodiscard]] uint32_t session_timeout_s() const { return session_timeout_s_; }
+
+        /// Whether the Public header of the last OPTIONS answer lists the method
+        [[nodiscard]] bool supports(const char *method) const { return public_.find(method) != std::string::npos; }
+
+        /// Why the last connect or request failed, e.g. "DESCRIBE 404 Not Found" or "PLAY timeout"
+        [[nodiscard]] const std::string &error() const { return error_; }
+
+        [[nodiscard]] const CoRtspConfig &config() const { return config_; }
+
+        net::CoSocket &socket() { return socket_; }
+
+    private:
+        /// Parse the input, true once the response to cseq was taken into response
+        bool take_input(int cseq, RtspMsg *response) {
+            net::MirrorBuffer &in = socket_.in();
+            bool found = false;
+            const long consumed = consume_rtsp_stream(
+                    in.data(), in.size(),
+                    [this](uint8_t channel, const uint8_t *data, size_t size) {
+                        if (interleaved_cb_) interleaved_cb_(channel, data, size);
+                        return socket_.is_open();
+                    },
+                    [this, cseq, response, &found](const RtspMsg &msg) {
+                        if (!msg.response) {
+                            // server requests (ANNOUNCE/SET_PARAMETER/...) are acknowledged and ignored
+                            const std::string ok = build_rtsp_response(200, "OK", msg.cseq());
+                            return socket_.write(ok.data(), ok.size());
+                        }
+                        if (response == nullptr || msg.cseq() != cseq) return true; // e.g. a keepalive answer
+                        *response = msg;
+                        found = true;
+                        return false;
+                    }
+            );
+            if (!socket_.is_open()) return false;
+            if (consumed < 0) {
+                socket_.close();
+                return false;
+            }
+            in.consume(static_cast<size_t>(consumed));
+            return found;
+        }
+
+        void take_session(const RtspMsg &msg) {
+            session_ = msg.session();
+            const std::string value = msg.header("Session");
+            const size_t pos = value.find("timeout=");
+            if (pos != std::string::npos) {
+                session_timeout_s_ = static_cast<uint32_t>(std::strtoul(value.c_str() + pos + 8, nullptr, 10));
+            }
+        }
+
+    private:
+        net::CoSocket socket_;
+        CoRtspConfig config_;
+        InterleavedCallback interleaved_cb_;
+
+        RtspUrl parsed_;
+        std::string url_;
+        int cseq_{0};
+        RtspAuth auth_;
+        std::string session_;
+        uint32_t session_timeout_s_{60};
+        std::string public_;
+        std::string error_;
+    };
+
+    /// Open the RTP/RTCP socket pair of media index for UDP transport and return its ports, false fails SETUP
+    using CoUdpOpener = std::function<bool(size_t index, uint16_t ports[2])>;
+
+    /*
+     * OPTIONS, DESCRIBE, SETUP for every supported media and PLAY on a connected connection. Fills the medias
+     * and the interleaved RTP channel of each. Without open_udp all medias go TCP interleaved; with it SETUP
+     * asks for UDP client ports (channel -1) and falls back to interleaved once the server answers 461.
+     */
+    static inline net::CoTask<bool> rtsp_play(CoRtspConnection &conn, std::vector<SdpMedia> &medias,
+                                              std::vector<int> &channels, CoUdpOpener open_udp = nullptr) {
+        medias.clear();
+        channels.clear();
+        const std::string url = conn.url();
+
+        RtspMsg msg = co_await conn.request("OPTIONS", url);
+        if (msg.status != 200) co_return false;
+
+        const CoRtspConnection::Headers accept{{"Accept", "application/sdp"}};
+        msg = co_await conn.request("DESCRIBE", url, accept);
+        if (msg.status != 200) co_return false;
+        std::string base_url = msg.header("Content-Base");
+        if (base_url.empty()) base_url = msg.header("Content-Location");
+        if (base_url.empty()) base_url = url;
+
+        for (auto &media: parse_sdp(msg.body)) {
+            const bool used = std::any_of(medias.begin(), medias.end(), [&media](const SdpMedia &m) {
+                return m.track == media.track;
+            });
+            if (media.codec == NONE || used) continue;
+
+            const size_t index = medias.size();
+            const std::string control = rtsp_control_url(base_url, media.control);
+            if (open_udp) {
+                uint16_t ports[2];
+                if (!open_udp(index, ports)) co_return false;
+                const CoRtspConnection::Headers setup{{"Transport", "RTP/AVP;unicast;client_port=" +
+                                                                    std::to_string(ports[0]) + "-" +
+                                                                    std::to_string(ports[1])}};
+                msg = co_await conn.request("SETUP", control, setup);
+                if (msg.status == 200) {
+                    medias.push_back(std::move(media));
+                    channels.push_back(-1);
+                    continue;
+                }
+                if (msg.status != 461) co_return false;
+                open_udp = nullptr; // UDP blocked, this and the remaining medias go interleaved
+            }
+
+            const std::string transport = "RTP/AVP/TCP;unicast;interleaved=" + std::to_string(index * 2) + "-" +
+                                          std::to_string(index * 2 + 1);
+            const CoRtspConnection::Headers setup{{"Transport", transport}};
+            msg = co_await conn.request("SETUP", control, setup);
+            if (msg.status != 200) co_return false;
+
+            const RtspTransport answer = parse_rtsp_transport(msg.header("Transport"));
+            const int channel = answer.interleaved[0] >= 0 ? answer.interleaved[0] : static_cast<int>(index * 2);
+            if (channel > 254) co_return false;
+            medias.push_back(std::move(media));
+            channels.push_back(channel);
+        }
+        if (medias.empty()) co_return false;
+
+        const CoRtspConnection::Headers range{{"Range", "npt=0.000-"}};
+        msg = co_await conn.request("PLAY", base_url, range);
+        co_return msg.status == 200;
+    }
+
+    /*
+     * ANNOUNCE the medias, SETUP each in record mode on interleaved channels 2i/2i+1 and RECORD.
+     * Afterwards packets go out with send_interleaved(2 * i, ...); keep calling pump() to drain RTCP.
+     */
+    static inline net::CoTask<bool> rtsp_record(CoRtspConnection &conn, const std::vector<SdpMedia> &medias) {
+        const std::string url = conn.url();
+
+        std::string sdp = "v=0\r\no=- 0 0 IN IP4 0.0.0.0\r\ns=rtspx\r\nt=0 0\r\n";
+        for (const auto &media: medias) sdp += build_sdp_media(media);
+
+        RtspMsg msg = co_await conn.request("OPTIONS", url);
+        if (msg.status != 200) co_return false;
+        const CoRtspConnection::Headers content_type{{"Content-Type", "application/sdp"}};
+        msg = co_await conn.request("ANNOUNCE", url, content_type, sdp);
+        if (msg.status != 200) co_return false;
+
+        for (size_t i = 0; i < medias.size(); ++i) {
+            const std::string transport = "RTP/AVP/TCP;unicast;interleaved=" + std::to_string(i * 2) + "-" +
+                                          std::to_string(i * 2 + 1) + ";mode=record";
+            const CoRtspConnection::Headers setup{{"Transport", transport}};
+            msg = co_await conn.request("SETUP", rtsp_control_url(url, medias[i].control), setup);
+            if (msg.status != 200) co_return false;
+        }
+
+        const CoRtspConnection::Headers range{{"Range", "npt=0.000-"}};
+        msg = co_await conn.request("RECORD", url, range);
+        co_return msg.status == 200;
+    }
+}
+
+#endif
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <functional>
+
+#include "rtspx/sessionx.h"
+
+namespace rtspx {
+    /*
+     * Viewer demand of one MediaSession, so producers can idle while nobody watches.
+     *
+     * The state turns active when the first client connects and idle once the last one has been gone for
+     * linger_ms (a quick reconnect does not restart the pipeline). Every join also raises a keyframe request,
+     * the new viewer cannot decode before the next IDR.
+     *
+     * Callbacks run on the thread that reports the change: the server thread for joins, the caller of
+     * check()/is_active() for the linger expiry. Either register callbacks and call check() periodically,
+     * or just poll is_active()/take_keyframe_request() from the producer loop.
+     */
+    class SessionDemand : public std::enable_shared_from_this<SessionDemand> {
+    public:
+        using DemandCallback = std::function<void(bool active)>;
+        using KeyframeCallback = std::function<void()>;
+
+        explicit SessionDemand(uint32_t linger_ms = 5000) : linger_ms_(linger_ms) {
+        }
+
+        SessionDemand(const SessionDemand &) = delete;
+
+        SessionDemand &operator=(const SessionDemand &) = delete;
+
+        /// Hook the session notify callbacks, the session keeps only a weak reference to this
+        void attach(const std::shared_ptr<MediaSession> &session) {
+            std::weak_ptr<SessionDemand> weak = shared_from_this();
+            session->add_connected_notify_callback([weak](uint32_t, const std::string &, uint16_t) {
+                if (auto self = weak.lock()) self->on_connected();
+            });
+            session->add_disconnected_notify_callback([weak](uint32_t, const std::string &, uint16_t) {
+                if (auto self = weak.lock()) self->on_disconnected();
+            });
+        }
+
+        void set_demand_callback(DemandCallback cb) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            demand_cb_ = std::move(cb);
+        }
+
+        void set_keyframe_callback(KeyframeCallback cb) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            keyframe_cb_ = std::move(cb);
+        }
+
+        /// Viewers now, or within the linger window
+        bool is_active() {
+            check();
+            return active_.load(std::memory_order_acquire);
+        }
+
+        [[nodiscard]] uint32_t num_viewers() const { return viewers_.load(std::memory_order_acquire); }
+
+        /// True once per join since the last call
+        bool take_keyframe_request() { return keyframe_requested_.exchange(false, std::memory_order_acq_rel); }
+
+        /// Turn idle when the linger window has passed, call periodically when using the demand callback
+        void check() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!active_.load(std::memory_order_relaxed) || viewers_.load(std::memory_order_relaxed) != 0) return;
+                if (now_ms() - last_leave_ms_ < static_cast<int64_t>(linger_ms_)) return;
+                active_.store(false, std::memory_order_release);
+            }
+            notify();
+        }
+
+        /// Joins/leaves for sessions served by something other than MediaSession (e.g. a relay or HTTP viewer)
+        void on_connected() {
+            KeyframeCallback keyframe_cb;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                viewers_.fetch_add(1, std::memory_order_acq_rel);
+                active_.store(true, std::memory_order_release);
+                keyframe_requested_.store(true, std::memory_order_release);
+                keyframe_cb = keyframe_cb_;
+            }
+            notify();
+            if (keyframe_cb) keyframe_cb();
+        }
+
+        void on_disconnected() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (viewers_.load(std::memory_order_relaxed) == 0) return;
+            if (viewers_.fetch_sub(1, std::memory_order_acq_rel) == 1) last_leave_ms_ = now_ms();
+        }
+
+        static std::shared_ptr<SessionDemand> create(const std::shared_ptr<MediaSession> &session,
+                                                     uint32_t linger_ms = 5000) {
+            auto demand = std::make_shared<SessionDemand>(linger_ms);
+            if (session) demand->attach(session);
+            return demand;
+        }
+
+    private:
+        /// Report the current state if it differs from the last report, racing join/expiry end on the latest
+        void notify() {
+            std::lock_guard<std::recursive_mutex> lock(notify_mutex_);
+            const bool active = active_.load(std::memory_order_acquire);
+            if (active == notified_) return;
+            notified_ = active;
+
+            DemandCallback cb;
+            {
+                std::lock_guard<std::mutex> state_lock(mutex_);
+                cb = demand_cb_;
+            }
+            if (cb) cb(active);
+        }
+
+        static int64_t now_ms() {
+            using namespace std::chrono;
+            return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+        }
+
+    private:
+        uint32_t linger_ms_;
+
+        std::mutex mutex_;
+        std::atomic<uint32_t> viewers_{0};
+        std::atomic<bool> active_{false};
+        std::atomic<bool> keyframe_requested_{false};
+        int64_t last_leave_ms_{0};
+
+        std::recursive_mutex notify_mutex_;
+        bool notified_{false};
+
+        DemandCallback demand_cb_;
+        KeyframeCallback keyframe_cb_;
+    };
+}
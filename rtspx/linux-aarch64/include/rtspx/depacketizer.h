@@ -0,0 +1,461 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "rtspx/rtp.h"
+#include "rtspx/types.h"
+
+namespace rtspx {
+    struct DepacketizerConfig {
+        CodecType codec{NONE};
+        uint32_t clock_rate{90000};
+
+        // AAC (RFC 3640 mpeg4-generic, AAC-hbr mode)
+        uint8_t aac_object_type{2};
+        uint32_t sample_rate{44100};
+        uint8_t channels{2};
+        int size_length{13};
+        int index_length{3};
+        int index_delta_length{3};
+        bool adts{true}; // prepend ADTS header, AACSource expects ADTS input
+    };
+
+    /// MPEG-4 samplingFrequencyIndex as used by ADTS and AudioSpecificConfig, 44100 when unknown
+    static inline uint8_t aac_frequency_index(uint32_t sample_rate) {
+        static constexpr uint32_t rates[] = {
+                96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+        };
+        for (uint8_t i = 0; i < sizeof(rates) / sizeof(rates[0]); ++i) {
+            if (rates[i] == sample_rate) return i;
+        }
+        return 4;
+    }
+
+    /*
+     * RTP -> access unit reassembly. Each complete frame is delivered once through the frame callback
+     * as EncodedShared, the holder keeps the assembled buffer alive so downstream fan-out never copies it.
+     *
+     * H.264/H.265 frames are Annex-B (00 00 00 01 before each NAL), pts is the unwrapped RTP timestamp
+     * counted from the first packet, rtp_timestamp is the timestamp as received.
+     */
+    class Depacketizer {
+    public:
+        using FrameCallback = std::function<void(const EncodedShared &frame)>;
+
+        explicit Depacketizer(const DepacketizerConfig &config) : config_(config) {
+        }
+
+        virtual ~Depacketizer() = default;
+
+        Depacketizer(const Depacketizer &) = delete;
+
+        Depacketizer &operator=(const Depacketizer &) = delete;
+
+        void input(const uint8_t *data, size_t size) {
+            RtpHeaderView rtp;
+            if (parse_rtp_header(data, size, rtp)) input(rtp);
+        }
+
+        void input(const RtpHeaderView &rtp) {
+            if (rtp.payload_size == 0) return;
+
+            if (has_seq_ && rtp_seq_diff(last_seq_, rtp.seq) <= 0) return; // duplicate or reordered late
+
+            const bool lost = has_seq_ && static_cast<uint16_t>(last_seq_ + 1) != rtp.seq;
+            if (lost) num_lost_ += static_cast<uint16_t>(rtp.seq - last_seq_ - 1);
+
+            has_seq_ = true;
+            last_seq_ = rtp.seq;
+            on_packet(rtp, lost);
+        }
+
+        void set_frame_callback(FrameCallback cb) { callback_ = std::move(cb); }
+
+        [[nodiscard]] const DepacketizerConfig &config() const { return config_; }
+
+        [[nodiscard]] uint64_t num_frames() const { return num_frames_; }
+
+        [[nodiscard]] uint64_t num_lost() const { return num_lost_; }
+
+        [[nodiscard]] uint64_t num_dropped() const { return num_dropped_; }
+
+        virtual void reset() {
+            has_seq_ = false;
+            has_ts_ = false;
+            buffer_.clear();
+        }
+
+        static std::unique_ptr<Depacketizer> create(const DepacketizerConfig &config);
+
+    protected:
+        virtual void on_packet(const RtpHeaderView &rtp, bool lost) = 0;
+
+        int64_t unwrap(uint32_t ts) {
+            if (!has_ts_) {
+                has_ts_ = true;
+                last_ts_ = ts;
+                ext_ts_ = 0;
+                return 0;
+            }
+            ext_ts_ += static_cast<int32_t>(ts - last_ts_);
+            last_ts_ = ts;
+            return ext_ts_;
+        }
+
+        void append(const uint8_t *data, size_t size) {
+            buffer_.insert(buffer_.end(), data, data + size);
+        }
+
+        void append_start_code() {
+            static constexpr uint8_t start_code[4] = {0x00, 0x00, 0x00, 0x01};
+            append(start_code, sizeof(start_code));
+        }
+
+        /// Hand the assembled buffer to the callback, the next frame starts in a buffer of the same capacity
+        void emit(uint32_t rtp_timestamp, FrameType type) {
+            if (buffer_.empty()) return;
+
+            const size_t capacity = buffer_.capacity();
+            auto holder = std::make_shared<std::vector<uint8_t> >(std::move(buffer_));
+            buffer_ = std::vector<uint8_t>();
+            buffer_.reserve(capacity);
+
+            ++num_frames_;
+            if (callback_) {
+                const EncodedShared frame(
+                        holder->data(), holder->size(), unwrap(rtp_timestamp), rtp_timestamp, holder, type
+                );
+                callback_(frame);
+            }
+        }
+
+        void drop() {
+            if (!buffer_.empty()) ++num_dropped_;
+            buffer_.clear();
+        }
+
+    protected:
+        DepacketizerConfig config_;
+        FrameCallback callback_{};
+        std::vector<uint8_t> buffer_{};
+
+        uint64_t num_frames_{0};
+        uint64_t num_lost_{0};
+        uint64_t num_dropped_{0};
+
+    private:
+        bool has_seq_{false};
+        uint16_t last_seq_{0};
+
+        bool has_ts_{false};
+        uint32_t last_ts_{0};
+        int64_t ext_ts_{0};
+    };
+
+    /// RFC 6184: single NAL, STAP-A, FU-A
+    class H264Depacketizer : public Depacketizer {
+    public:
+        using Depacketizer::Depacketizer;
+
+        void reset() override {
+            Depacketizer::reset();
+            started_ = false;
+            in_fu_ = false;
+            damaged_ = false;
+            key_ = false;
+        }
+
+    protected:
+        void on_packet(const RtpHeaderView &rtp, bool lost) override {
+            if (started_ && rtp.timestamp != timestamp_) {
+                if (lost) damaged_ = true;
+                flush();
+            }
+            if (lost) {
+                damaged_ = true;
+                in_fu_ = false;
+            }
+            started_ = true;
+            timestamp_ = rtp.timestamp;
+
+            const uint8_t *p = rtp.payload;
+            const size_t size = rtp.payload_size;
+            const uint8_t type = p[0] & 0x1F;
+
+            if (type >= 1 && type <= 23) {
+                append_nal(p, size);
+            } else if (type == 24) {
+                size_t offset = 1;
+                while (offset + 2 <= size) {
+                    const size_t nal_size = read_be16(p + offset);
+                    offset += 2;
+                    if (nal_size == 0 || offset + nal_size > size) break;
+                    append_nal(p + offset, nal_size);
+                    offset += nal_size;
+                }
+            } else if (type == 28 && size > 2) {
+                const uint8_t fu_header = p[1];
+                if (fu_header & 0x80) {
+                    const uint8_t nal_header = (p[0] & 0xE0) | (fu_header & 0x1F);
+                    append_start_code();
+                    append(&nal_header, 1);
+                    mark(nal_header & 0x1F);
+                    in_fu_ = true;
+                }
+                if (in_fu_) {
+                    append(p + 2, size - 2);
+                    if (fu_header & 0x40) in_fu_ = false;
+                }
+            }
+
+            if (rtp.marker) flush();
+        }
+
+    private:
+        void append_nal(const uint8_t *nal, size_t size) {
+            append_start_code();
+            append(nal, size);
+            mark(nal[0] & 0x1F);
+        }
+
+        void mark(uint8_t type) {
+            if (type == 5 || type == 7) key_ = true;
+        }
+
+        void flush() {
+            if (damaged_ || in_fu_) drop();
+            else emit(timestamp_, key_ ? VIDEO_FRAME_I : VIDEO_FRAME_P);
+
+            started_ = false;
+            in_fu_ = false;
+            damaged_ = false;
+            key_ = false;
+        }
+
+    private:
+        bool started_{false};
+        bool in_fu_{false};
+        bool damaged_{false};
+        bool key_{false};
+        uint32_t timestamp_{0};
+    };
+
+    /// RFC 7798: single NAL, AP, FU (no DONL, sprop-max-don-diff = 0)
+    class H265Depacketizer : public Depacketizer {
+    public:
+        using Depacketizer::Depacketizer;
+
+        void reset() override {
+            Depacketizer::reset();
+            started_ = false;
+            in_fu_ = false;
+            damaged_ = false;
+            key_ = false;
+        }
+
+    protected:
+        void on_packet(const RtpHeaderView &rtp, bool lost) override {
+            if (started_ && rtp.timestamp != timestamp_) {
+                if (lost) damaged_ = true;
+                flush();
+            }
+            if (lost) {
+                damaged_ = true;
+                in_fu_ = false;
+            }
+            started_ = true;
+            timestamp_ = rtp.timestamp;
+
+            const uint8_t *p = rtp.payload;
+            const size_t size = rtp.payload_size;
+            if (size < 2) return;
+
+            const uint8_t type = (p[0] >> 1) & 0x3F;
+
+            if (type < 48) {
+                append_nal(p, size);
+            } else if (type == 48) {
+                size_t offset = 2;
+                while (offset + 2 <= size) {
+                    const size_t nal_size = read_be16(p + offset);
+                    offset += 2;
+                    if (nal_size < 2 || offset + nal_size > size) break;
+                    append_nal(p + offset, nal_size);
+                    offset += nal_size;
+                }
+            } else if (type == 49 && size > 3) {
+                const uint8_t fu_header = p[2];
+                if (fu_header & 0x80) {
+                    const uint8_t nal_type = fu_header & 0x3F;
+                    const uint8_t nal_header[2] = {
+                            static_cast<uint8_t>((p[0] & 0x81) | (nal_type << 1)), p[1]
+                    };
+                    append_start_code();
+                    append(nal_header, 2);
+                    mark(nal_type);
+                    in_fu_ = true;
+                }
+                if (in_fu_) {
+                    append(p + 3, size - 3);
+                    if (fu_header & 0x40) in_fu_ = false;
+                }
+            }
+
+            if (rtp.marker) flush();
+        }
+
+    private:
+        void append_nal(const uint8_t *nal, size_t size) {
+            append_start_code();
+            append(nal, size);
+            mark((nal[0] >> 1) & 0x3F);
+        }
+
+        void mark(uint8_t type) {
+            if ((type >= 16 && type <= 21) || (type >= 32 && type <= 34)) key_ = true;
+        }
+
+        void flush() {
+            if (damaged_ || in_fu_) drop();
+            else emit(timestamp_, key_ ? VIDEO_FRAME_I : VIDEO_FRAME_P);
+
+            started_ = false;
+            in_fu_ = false;
+            damaged_ = false;
+            key_ = false;
+        }
+
+    private:
+        bool started_{false};
+        bool in_fu_{false};
+        bool damaged_{false};
+        bool key_{false};
+        uint32_t timestamp_{0};
+    };
+
+    /// RFC 3640 AAC-hbr/lbr: AU-headers section followed by one or more AUs, or one fragmented AU
+    class AACDepacketizer : public Depacketizer {
+    public:
+        using Depacketizer::Depacketizer;
+
+        void reset() override {
+            Depacketizer::reset();
+            fragment_size_ = 0;
+        }
+
+    protected:
+        void on_packet(const RtpHeaderView &rtp, bool lost) override {
+            if (lost && fragment_size_ != 0) {
+                drop();
+                fragment_size_ = 0;
+            }
+
+            const uint8_t *p = rtp.payload;
+            const size_t size = rtp.payload_size;
+            if (size < 2) return;
+
+            const size_t headers_bits = read_be16(p);
+            const size_t headers_bytes = (headers_bits + 7) / 8;
+            if (2 + headers_bytes > size) return;
+
+            size_t au_sizes[64];
+            size_t num_au = 0;
+            size_t bit = 0;
+            while (bit < headers_bits && num_au < 64) {
+                const int index_bits = num_au == 0 ? config_.index_length : config_.index_delta_length;
+                if (bit + config_.size_length + index_bits > headers_bits) break;
+                au_sizes[num_au++] = read_bits(p + 2, bit, config_.size_length);
+                bit += config_.size_length + index_bits;
+            }
+
+            const uint8_t *data = p + 2 + headers_bytes;
+            const uint8_t *end = p + size;
+
+            if (num_au == 1 && (fragment_size_ != 0 || data + au_sizes[0] > end)) {
+                // AU larger than one packet, continue until marker
+                if (fragment_size_ == 0) begin_frame(au_sizes[0]);
+                fragment_size_ = au_sizes[0];
+                append(data, end - data);
+                if (rtp.marker) {
+                    if (buffer_.size() == fragment_size_ + header_size()) emit(rtp.timestamp, AUDIO_FRAME);
+                    else drop();
+                    fragment_size_ = 0;
+                }
+                return;
+            }
+
+            uint32_t timestamp = rtp.timestamp;
+            for (size_t i = 0; i < num_au; ++i) {
+                if (data + au_sizes[i] > end) break;
+                begin_frame(au_sizes[i]);
+                append(data, au_sizes[i]);
+                emit(timestamp, AUDIO_FRAME);
+                data += au_sizes[i];
+                timestamp += 1024;
+            }
+        }
+
+    private:
+        [[nodiscard]] size_t header_size() const { return config_.adts ? 7 : 0; }
+
+        static size_t read_bits(const uint8_t *p, size_t bit, int count) {
+            size_t value = 0;
+            for (int i = 0; i < count; ++i, ++bit) {
+                value = (value << 1) | ((p[bit >> 3] >> (7 - (bit & 7))) & 0x01);
+            }
+            return value;
+        }
+
+        void begin_frame(size_t au_size) {
+            buffer_.clear();
+            if (!config_.adts) return;
+
+            const uint8_t freq_index = aac_frequency_index(config_.sample_rate);
+            const uint8_t profile = config_.aac_object_type > 0 ? config_.aac_object_type - 1 : 1;
+            const uint8_t channels = config_.channels;
+            const size_t length = au_size + 7;
+
+            const uint8_t adts[7] = {
+                    0xFF, 0xF1,
+                    static_cast<uint8_t>(((profile & 0x03) << 6) | (freq_index << 2) | ((channels >> 2) & 0x01)),
+                    static_cast<uint8_t>(((channels & 0x03) << 6) | ((length >> 11) & 0x03)),
+                    static_cast<uint8_t>((length >> 3) & 0xFF),
+                    static_cast<uint8_t>(((length & 0x07) << 5) | 0x1F),
+                    0xFC
+            };
+            append(adts, sizeof(adts));
+        }
+
+    private:
+        size_t fragment_size_{0};
+    };
+
+    /// G.711 carries raw samples, one packet is one frame
+    class G711ADepacketizer : public Depacketizer {
+    public:
+        using Depacketizer::Depacketizer;
+
+    protected:
+        void on_packet(const RtpHeaderView &rtp, bool) override {
+            append(rtp.payload, rtp.payload_size);
+            emit(rtp.timestamp, AUDIO_FRAME);
+        }
+    };
+
+    inline std::unique_ptr<Depacketizer> Depacketizer::create(const DepacketizerConfig &config) {
+        switch (config.codec) {
+            case H264:
+                return std::make_unique<H264Depacketizer>(config);
+            case H265:
+                return std::make_unique<H265Depacketizer>(config);
+            case AAC:
+                return std::make_unique<AACDepacketizer>(config);
+            case PCMA:
+                return std::make_unique<G711ADepacketizer>(config);
+            default:
+                return nullptr;
+        }
+    }
+}
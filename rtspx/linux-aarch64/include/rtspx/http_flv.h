@@ -0,0 +1,583 @@
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <unordered_map>
+
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "rtspx/flv.h"
+#include "rtspx/demand.h"
+#include "rtspx/poller.h"
+#include "rtspx/rendition.h"
+
+namespace rtspx {
+    struct HttpFlvConfig {
+        size_t max_queue_bytes{4 * 1024 * 1024}; // per viewer, beyond this it skips to the next keyframe
+        size_t max_gop_bytes{2 * 1024 * 1024}; // GOP cache, at most max_queue_bytes / 2; a longer GOP is not cached
+        uint32_t request_timeout_ms{10000}; // connections that do not send a request in time are closed
+    };
+
+    class HttpFlvServer;
+
+    /*
+     * One stream served at http://host:port/<suffix>.flv, the HTTP counterpart of a MediaSession.
+     *
+     * Push the same EncodedShared frames that go into MediaSession::push_data, each frame is muxed once into
+     * a refcounted FLV tag that every HTTP viewer shares. push_data() is thread-safe.
+     *
+     * With more than one rendition (HttpFlvServer::add_adaptive_stream) every viewer gets its own
+     * RenditionSwitcher fed with its send queue and blocked time, and follows the rendition its connection
+     * can carry. Frames are then muxed per viewer, one mux per viewer and frame instead of one per frame.
+     */
+    class HttpFlvStream : public std::enable_shared_from_this<HttpFlvStream> {
+    public:
+        HttpFlvStream(std::string suffix, const FlvConfig &config, std::shared_ptr<SessionDemand> demand,
+                      size_t renditions = 1, const RenditionSwitcherConfig &switcher = {})
+                : suffix_(std::move(suffix)), demand_(std::move(demand)), renditions_(std::max<size_t>(renditions, 1)),
+                  switcher_config_(switcher), muxer_(config) {
+            auto header = std::make_shared<std::string>(
+                    "HTTP/1.1 200 OK\r\n"
+                    "Content-Type: video/x-flv\r\n"
+                    "Cache-Control: no-cache\r\n"
+                    "Connection: close\r\n"
+                    "Access-Control-Allow-Origin: *\r\n\r\n");
+            *header += muxer_.header();
+            response_ = std::move(header);
+            has_video_ = config.video != NONE;
+        }
+
+        HttpFlvStream(const HttpFlvStream &) = delete;
+
+        HttpFlvStream &operator=(const HttpFlvStream &) = delete;
+
+        /// Adaptive streams take this as rendition 0
+        bool push_data(MediaTrack track, const EncodedShared &frame);
+
+        /// A frame of rendition index (0 .. renditions - 1) of an adaptive stream
+        bool push_data(size_t index, MediaTrack track, const EncodedShared &frame);
+
+        [[nodiscard]] const std::string &get_url_suffix() const { return suffix_; }
+
+        [[nodiscard]] size_t get_num_renditions() const { return renditions_; }
+
+        [[nodiscard]] size_t get_num_client() const { return num_viewers_.load(std::memory_order_relaxed); }
+
+    private:
+        friend class HttpFlvServer;
+
+        const std::string suffix_;
+        const std::shared_ptr<SessionDemand> demand_;
+        const size_t renditions_;
+        const RenditionSwitcherConfig switcher_config_;
+
+        std::mutex mutex_; // muxer_ and server_
+        FlvMuxer muxer_;
+        HttpFlvServer *server_{nullptr};
+
+        // loop thread only
+        FlvTag response_; // HTTP response head + FLV header
+        FlvTag video_config_;
+        FlvTag audio_config_;
+        std::vector<FlvTag> gop_; // tags since the last keyframe
+        size_t gop_bytes_{0};
+        bool has_video_{false};
+        std::vector<int> viewers_;
+        std::atomic<size_t> num_viewers_{0};
+    };
+
+    /*
+     * HTTP-FLV egress next to an RtspServer, for browser players (flv.js, mpegts.js) without a remux process.
+     *
+     * Runs its own Poller. A new viewer gets the sequence headers and the cached GOP, so playback starts at
+     * once from the last keyframe. A viewer that cannot keep up has its backlog dropped and resumes at the
+     * next keyframe, it never stalls the producer or the other viewers. With a SessionDemand the viewers
+     * count towards the demand (and keyframe requests) of the stream.
+     *
+     * An adaptive stream switches renditions per viewer: every REPORT_INTERVAL_MS the viewer's queue depth and
+     * the time its socket was not writable go into its RenditionSwitcher, a dropped backlog counts as a full
+     * queue.
+     */
+    class HttpFlvServer {
+    public:
+        explicit HttpFlvServer(const HttpFlvConfig &config = {}) : config_(config) {
+            // a new viewer gets the whole cached GOP queued at once, it must leave room for the live tags
+            config_.max_gop_bytes = std::min(config_.max_gop_bytes, config_.max_queue_bytes / 2);
+        }
+
+        ~HttpFlvServer() { stop(); }
+
+        HttpFlvServer(const HttpFlvServer &) = delete;
+
+        HttpFlvServer &operator=(const HttpFlvServer &) = delete;
+
+        bool start(const std::string &ip, uint16_t port) {
+            if (listen_fd_ >= 0) return false;
+
+            listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listen_fd_ < 0) return false;
+
+            const int on = 1;
+            ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = ip.empty() ? INADDR_ANY : ::inet_addr(ip.c_str());
+            if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+                ::listen(listen_fd_, SOMAXCONN) != 0) {
+                ::close(listen_fd_);
+                listen_fd_ = -1;
+                return false;
+            }
+
+            poller_.add(listen_fd_, EPOLLIN, [this](uint32_t) { on_accept(); });
+            timer_id_ = poller_.add_timer(1000, [this]() {
+                check_timeout();
+                return true;
+            });
+            return poller_.start();
+        }
+
+        void stop() {
+            poller_.stop();
+            if (timer_id_ != 0) poller_.remove_timer(timer_id_);
+            timer_id_ = 0;
+
+            std::vector<int> fds;
+            for (const auto &kv: viewers_) fds.push_back(kv.first);
+            for (const int fd: fds) close_viewer(fd);
+
+            if (listen_fd_ >= 0) {
+                poller_.remove(listen_fd_);
+                ::close(listen_fd_);
+                listen_fd_ = -1;
+            }
+
+            std::lock_guard<std::mutex> lock(streams_mutex_);
+            for (auto &kv: streams_) {
+                std::lock_guard<std::mutex> stream_lock(kv.second->mutex_);
+                kv.second->server_ = nullptr;
+            }
+            streams_.clear();
+        }
+
+        /// Serve a stream at /<suffix>.flv, nullptr when the suffix is taken
+        std::shared_ptr<HttpFlvStream> add_stream(const std::string &suffix, const FlvConfig &config,
+                                                  std::shared_ptr<SessionDemand> demand = nullptr) {
+            return add_adaptive_stream(suffix, 1, config, std::move(demand));
+        }
+
+        /// Serve renditions of one source (main/sub stream) at /<suffix>.flv, switched per viewer
+        std::shared_ptr<HttpFlvStream> add_adaptive_stream(const std::string &suffix, size_t renditions,
+                                                           const FlvConfig &config,
+                                                           std::shared_ptr<SessionDemand> demand = nullptr,
+                                                           const RenditionSwitcherConfig &switcher = {}) {
+            auto stream = std::make_shared<HttpFlvStream>(suffix, config, std::move(demand), renditions, switcher);
+            stream->server_ = this;
+
+            std::lock_guard<std::mutex> lock(streams_mutex_);
+            if (!streams_.emplace(suffix, stream).second) return nullptr;
+            return stream;
+        }
+
+        void remove_stream(const std::string &suffix) {
+            std::shared_ptr<HttpFlvStream> stream;
+            {
+                std::lock_guard<std::mutex> lock(streams_mutex_);
+                const auto it = streams_.find(suffix);
+                if (it == streams_.end()) return;
+                stream = std::move(it->second);
+                streams_.erase(it);
+            }
+            {
+                std::lock_guard<std::mutex> lock(stream->mutex_);
+                stream->server_ = nullptr;
+            }
+            poller_.post([this, stream]() {
+                const std::vector<int> fds = stream->viewers_;
+                for (const int fd: fds) close_viewer(fd);
+            });
+        }
+
+        [[nodiscard]] size_t num_viewers() const { return num_viewers_.load(); }
+
+        static std::shared_ptr<HttpFlvServer> create(const HttpFlvConfig &config = {}) {
+            return std::make_shared<HttpFlvServer>(config);
+        }
+
+    private:
+        friend class HttpFlvStream;
+
+        static constexpr size_t MAX_REQUEST_SIZE = 8 * 1024;
+        static constexpr int MAX_IOV = 64;
+        static constexpr int64_t REPORT_INTERVAL_MS = 500;
+
+        struct Viewer {
+            int fd{-1};
+            std::string in;
+            std::shared_ptr<HttpFlvStream> stream;
+            std::deque<FlvTag> queue;
+            size_t offset{0}; // sent bytes of queue.front()
+            size_t queued_bytes{0};
+            size_t pinned{0}; // leading queue tags (response, FLV header, sequence headers) never dropped
+            bool waiting_key{false};
+            bool closing{false}; // close once the queue is out (error responses)
+            int64_t accept_ms{0};
+
+            // time the socket was not writable, for the switcher
+            int64_t blocked_since_ms{0};
+            int64_t blocked_ms{0};
+
+            // adaptive streams only
+            std::unique_ptr<FlvMuxer> muxer;
+            std::unique_ptr<RenditionSwitcher> switcher;
+            int64_t report_ms{0};
+            bool dropped{false}; // backlog dropped since the last report
+        };
+
+        /// Loop thread: a frame muxed by HttpFlvStream::push_data
+        void deliver(const std::shared_ptr<HttpFlvStream> &stream, const FlvPacket &packet) {
+            HttpFlvStream &s = *stream;
+            if (packet.config) {
+                (packet.track == Video ? s.video_config_ : s.audio_config_) = packet.config;
+                for (const int fd: s.viewers_) enqueue(*viewers_[fd], packet.config);
+            }
+            if (!packet.tag) return;
+
+            if (s.has_video_) {
+                if (packet.track == Video && packet.keyframe) {
+                    s.gop_.clear();
+                    s.gop_bytes_ = 0;
+                }
+                if ((packet.track == Video && packet.keyframe) || !s.gop_.empty()) {
+                    s.gop_.push_back(packet.tag);
+                    s.gop_bytes_ += packet.tag->size();
+                    if (s.gop_bytes_ > config_.max_gop_bytes) {
+                        s.gop_.clear(); // uncached until the next keyframe
+                        s.gop_bytes_ = 0;
+                    }
+                }
+            }
+
+            std::vector<int> failed;
+            for (const int fd: s.viewers_) {
+                Viewer &viewer = *viewers_[fd];
+                send(viewer, packet.tag, packet.track == Video && packet.keyframe);
+                if (!flush(viewer)) failed.push_back(fd);
+            }
+            for (const int fd: failed) close_viewer(fd);
+        }
+
+        /// Loop thread: a frame of one rendition of an adaptive stream, each viewer's switcher picks what goes out
+        void deliver(const std::shared_ptr<HttpFlvStream> &stream, size_t index, MediaTrack track,
+                     const EncodedShared &frame) {
+            const int64_t now = net::now_ms();
+            std::vector<int> failed;
+            for (const int fd: stream->viewers_) {
+                Viewer &viewer = *viewers_[fd];
+                viewer.switcher->push(index, track, frame); // muxes into the queue through mux_to()
+                if (!flush(viewer)) failed.push_back(fd);
+                if (now - viewer.report_ms >= REPORT_INTERVAL_MS) report(viewer, now);
+            }
+            for (const int fd: failed) close_viewer(fd);
+        }
+
+        /// Loop thread: the viewer's switcher forwards a frame, it is muxed for this viewer alone
+        void mux_to(Viewer &viewer, MediaTrack track, const EncodedShared &frame) {
+            FlvPacket packet;
+            if (!viewer.muxer->mux(track, frame, packet)) return;
+            if (packet.config) enqueue(viewer, packet.config);
+            if (packet.tag) send(viewer, packet.tag, packet.track == Video && packet.keyframe);
+        }
+
+        void report(Viewer &viewer, int64_t now) {
+            int64_t blocked = viewer.blocked_ms;
+            if (viewer.blocked_since_ms != 0) {
+                blocked += now - viewer.blocked_since_ms;
+                viewer.blocked_since_ms = now;
+            }
+            size_t depth = viewer.queue.size();
+            if (viewer.dropped) depth = std::max(depth, viewer.stream->switcher_config_.queue_high);
+            viewer.switcher->report(depth, static_cast<uint32_t>(std::min<int64_t>(blocked, now - viewer.report_ms)));
+            viewer.blocked_ms = 0;
+            viewer.dropped = false;
+            viewer.report_ms = now;
+        }
+
+        /// Queue a frame tag, a viewer too far behind has its backlog dropped up to the next keyframe
+        void send(Viewer &viewer, const FlvTag &tag, bool keyframe) {
+            if (viewer.waiting_key && !keyframe) return;
+            viewer.waiting_key = false;
+
+            if (viewer.queued_bytes + tag->size() > config_.max_queue_bytes) {
+                drop_backlog(viewer);
+                // a keyframe restarts the viewer right away instead of being dropped with the backlog
+                if (keyframe) viewer.waiting_key = false;
+            }
+            if (!viewer.waiting_key) enqueue(viewer, tag);
+        }
+
+        static void enqueue(Viewer &viewer, const FlvTag &tag) {
+            viewer.queue.push_back(tag);
+            viewer.queued_bytes += tag->size();
+        }
+
+        /*
+         * Keep the tag on the wire and the unsent preamble (the FLV stream must stay well-formed), skip the rest
+         * up to a keyframe. A sequence header dropped with the backlog is queued again, the keyframe needs it.
+         */
+        void drop_backlog(Viewer &viewer) {
+            const HttpFlvStream &s = *viewer.stream;
+            const FlvTag &video_config_tag = viewer.muxer ? viewer.muxer->video_config() : s.video_config_;
+            const FlvTag &audio_config_tag = viewer.muxer ? viewer.muxer->audio_config() : s.audio_config_;
+            const size_t keep = std::min(std::max(viewer.pinned, viewer.offset != 0 ? size_t{1} : size_t{0}),
+                                         viewer.queue.size());
+            bool video_config = false;
+            bool audio_config = false;
+            for (size_t i = keep; i < viewer.queue.size(); ++i) {
+                const FlvTag &tag = viewer.queue[i];
+                video_config = video_config || tag == video_config_tag;
+                audio_config = audio_config || tag == audio_config_tag;
+                viewer.queued_bytes -= tag->size();
+            }
+            viewer.queue.erase(viewer.queue.begin() + static_cast<std::ptrdiff_t>(keep), viewer.queue.end());
+            if (video_config) enqueue(viewer, video_config_tag);
+            if (audio_config) enqueue(viewer, audio_config_tag);
+            viewer.waiting_key = s.has_video_;
+            viewer.dropped = true;
+        }
+
+        void on_accept() {
+            while (true) {
+                const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) return;
+
+                const int on = 1;
+                ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+                auto viewer = std::make_unique<Viewer>();
+                viewer->fd = fd;
+                viewer->accept_ms = net::now_ms();
+                viewers_[fd] = std::move(viewer);
+
+                // edge-triggered, EPOLLOUT stays armed and only fires when a blocked send may resume
+                poller_.add(fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, [this, fd](uint32_t events) {
+                    on_event(fd, events);
+                });
+            }
+        }
+
+        void on_event(int fd, uint32_t events) {
+            const auto it = viewers_.find(fd);
+            if (it == viewers_.end()) return;
+            Viewer &viewer = *it->second;
+
+            if (events & (EPOLLERR | EPOLLHUP)) {
+                close_viewer(fd);
+                return;
+            }
+
+            if (events & (EPOLLIN | EPOLLRDHUP)) {
+                char buf[4096];
+                while (true) {
+                    const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+                    if (n > 0) {
+                        if (!viewer.stream) viewer.in.append(buf, n); // anything after the request is ignored
+                        continue;
+                    }
+                    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+                    if (n < 0 && errno == EINTR) continue;
+                    close_viewer(fd);
+                    return;
+                }
+                if (!viewer.stream && !viewer.closing && !handle_request(viewer)) {
+                    close_viewer(fd);
+                    return;
+                }
+            }
+
+            if (!flush(viewer)) close_viewer(fd);
+        }
+
+        bool handle_request(Viewer &viewer) {
+            const size_t end = viewer.in.find("\r\n\r\n");
+            if (end == std::string::npos) return viewer.in.size() <= MAX_REQUEST_SIZE;
+
+            const size_t method_end = viewer.in.find(' ');
+            const size_t path_end = viewer.in.find(' ', method_end + 1);
+            if (method_end == std::string::npos || path_end == std::string::npos || path_end > end) {
+                return respond(viewer, "400 Bad Request");
+            }
+            if (viewer.in.compare(0, method_end, "GET") != 0) return respond(viewer, "405 Method Not Allowed");
+
+            std::string path = viewer.in.substr(method_end + 1, path_end - method_end - 1);
+            path = path.substr(0, path.find('?'));
+            if (!path.empty() && path[0] == '/') path.erase(0, 1);
+            if (path.size() > 4 && path.compare(path.size() - 4, 4, ".flv") == 0) path.resize(path.size() - 4);
+
+            std::shared_ptr<HttpFlvStream> stream;
+            {
+                std::lock_guard<std::mutex> lock(streams_mutex_);
+                const auto it = streams_.find(path);
+                if (it != streams_.end()) stream = it->second;
+            }
+            if (!stream) return respond(viewer, "404 Not Found");
+
+            viewer.in.clear();
+            viewer.stream = stream;
+            enqueue(viewer, stream->response_);
+            if (stream->renditions_ > 1) {
+                // sequence headers come from the viewer's own muxer, the switcher starts it at a keyframe
+                Viewer *v = &viewer;
+                viewer.muxer = std::make_unique<FlvMuxer>(stream->muxer_.config());
+                viewer.switcher = std::make_unique<RenditionSwitcher>(
+                        stream->renditions_, [this, v](MediaTrack track, const EncodedShared &frame) {
+                            mux_to(*v, track, frame);
+                        }, stream->switcher_config_);
+                viewer.pinned = viewer.queue.size();
+                viewer.report_ms = net::now_ms();
+            } else {
+                if (stream->video_config_) enqueue(viewer, stream->video_config_);
+                if (stream->audio_config_) enqueue(viewer, stream->audio_config_);
+                viewer.pinned = viewer.queue.size();
+                for (const auto &tag: stream->gop_) enqueue(viewer, tag);
+                viewer.waiting_key = stream->has_video_ && stream->gop_.empty();
+            }
+
+            stream->viewers_.push_back(viewer.fd);
+            stream->num_viewers_.fetch_add(1, std::memory_order_relaxed);
+            ++num_viewers_;
+            if (stream->demand_) stream->demand_->on_connected();
+            return true;
+        }
+
+        bool respond(Viewer &viewer, const std::string &status) {
+            enqueue(viewer, std::make_shared<const std::string>(
+                    "HTTP/1.1 " + status + "\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"));
+            viewer.closing = true;
+            return true;
+        }
+
+        bool flush(Viewer &viewer) {
+            while (!viewer.queue.empty()) {
+                iovec iov[MAX_IOV];
+                int count = 0;
+                for (auto it = viewer.queue.begin(); it != viewer.queue.end() && count < MAX_IOV; ++it, ++count) {
+                    const size_t skip = count == 0 ? viewer.offset : 0;
+                    iov[count].iov_base = const_cast<char *>((*it)->data() + skip);
+                    iov[count].iov_len = (*it)->size() - skip;
+                }
+
+                msghdr msg{};
+                msg.msg_iov = iov;
+                msg.msg_iovlen = static_cast<size_t>(count);
+                ssize_t n = ::sendmsg(viewer.fd, &msg, MSG_NOSIGNAL);
+                if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    if (viewer.blocked_since_ms == 0) viewer.blocked_since_ms = net::now_ms();
+                    return true; // EPOLLOUT edge resumes
+                }
+                if (n < 0 && errno == EINTR) continue;
+                if (n <= 0) return false;
+                if (viewer.blocked_since_ms != 0) {
+                    viewer.blocked_ms += net::now_ms() - viewer.blocked_since_ms;
+                    viewer.blocked_since_ms = 0;
+                }
+
+                while (n > 0) {
+                    const size_t left = viewer.queue.front()->size() - viewer.offset;
+                    if (static_cast<size_t>(n) < left) {
+                        viewer.offset += static_cast<size_t>(n);
+                        break;
+                    }
+                    n -= static_cast<ssize_t>(left);
+                    viewer.queued_bytes -= viewer.queue.front()->size();
+                    viewer.queue.pop_front();
+                    viewer.offset = 0;
+                    if (viewer.pinned > 0) --viewer.pinned;
+                }
+            }
+            return !viewer.closing;
+        }
+
+        void close_viewer(int fd) {
+            const auto it = viewers_.find(fd);
+            if (it == viewers_.end()) return;
+
+            std::unique_ptr<Viewer> viewer = std::move(it->second);
+            viewers_.erase(it);
+
+            if (viewer->stream) {
+                auto &fds = viewer->stream->viewers_;
+                fds.erase(std::remove(fds.begin(), fds.end(), fd), fds.end());
+                viewer->stream->num_viewers_.fetch_sub(1, std::memory_order_relaxed);
+                --num_viewers_;
+                if (viewer->stream->demand_) viewer->stream->demand_->on_disconnected();
+            }
+
+            poller_.remove(fd);
+            ::close(fd);
+        }
+
+        void check_timeout() {
+            const int64_t deadline = net::now_ms() - static_cast<int64_t>(config_.request_timeout_ms);
+            std::vector<int> expired;
+            for (const auto &kv: viewers_) {
+                if (!kv.second->stream && kv.second->accept_ms < deadline) expired.push_back(kv.first);
+            }
+            for (const int fd: expired) close_viewer(fd);
+        }
+
+    private:
+        HttpFlvConfig config_;
+
+        int listen_fd_{-1};
+        uint32_t timer_id_{0};
+        net::Poller poller_;
+
+        std::mutex streams_mutex_;
+        std::unordered_map<std::string, std::shared_ptr<HttpFlvStream> > streams_;
+
+        std::unordered_map<int, std::unique_ptr<Viewer> > viewers_;
+        std::atomic<size_t> num_viewers_{0};
+    };
+
+    inline bool HttpFlvStream::push_data(MediaTrack track, const EncodedShared &frame) {
+        if (renditions_ > 1) return push_data(0, track, frame);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (server_ == nullptr) return false;
+
+        FlvPacket packet;
+        if (!muxer_.mux(track, frame, packet)) return false;
+
+        // posted under the lock, so tags reach the loop in mux order
+        HttpFlvServer *server = server_;
+        server->poller_.post([server, self = shared_from_this(), packet]() {
+            server->deliver(self, packet);
+        });
+        return true;
+    }
+
+    inline bool HttpFlvStream::push_data(size_t index, MediaTrack track, const EncodedShared &frame) {
+        if (renditions_ == 1) return index == 0 && push_data(track, frame);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (server_ == nullptr || index >= renditions_) return false;
+
+        // muxed per viewer on the loop, after its switcher picked the frame
+        HttpFlvServer *server = server_;
+        server->poller_.post([server, self = shared_from_this(), index, track, frame]() {
+            server->deliver(self, index, track, frame);
+        });
+        return true;
+    }
+}
@@ -0,0 +1,500 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+
+#include "rtspx/rtp.h"
+#include "rtspx/sdp.h"
+#include "rtspx/types.h"
+#include "rtspx/latency.h"
+
+namespace rtspx {
+    struct PacketizerConfig {
+        CodecType codec{NONE};
+        uint8_t payload_type{96};
+        uint32_t ssrc{0}; // 0 = random (RFC 3550 8.1)
+        size_t mtu{1400}; // max RTP packet size (header + payload), without the TCP interleave head
+        bool aggregate{true}; // STAP-A/AP for small NAL units
+        uint8_t abs_capture_time_id{0}; // RFC 8285 one-byte id (1..14) of abs-capture-time, 0 = off
+
+        // audio
+        uint32_t sample_rate{44100};
+        uint8_t channels{2};
+        uint8_t aac_object_type{2}; // AAC-LC
+        uint32_t aac_frames{1}; // AUs per RTP packet (RFC 3640 AU-headers), 1 keeps one packet per frame
+        uint32_t ptime_ms{20}; // G.711 packet duration
+    };
+
+    /// Call fn(nal, size) for every NAL unit of an Annex-B buffer, start codes stripped
+    template<typename Fn>
+    static inline void for_each_annexb_nal(const uint8_t *data, size_t size, Fn &&fn) {
+        auto find_start = [data, size](size_t from, size_t &code_size) {
+            for (size_t i = from; i + 3 <= size; ++i) {
+                if (data[i] != 0 || data[i + 1] != 0) continue;
+                if (data[i + 2] == 1) {
+                    code_size = 3;
+                    return i;
+                }
+                if (i + 4 <= size && data[i + 2] == 0 && data[i + 3] == 1) {
+                    code_size = 4;
+                    return i;
+                }
+            }
+            code_size = 0;
+            return size;
+        };
+
+        size_t code_size = 0;
+        size_t start = find_start(0, code_size);
+        if (start == size) {
+            if (size > 0) fn(data, size); // no start code, a bare NAL
+            return;
+        }
+        while (start < size) {
+            const size_t nal = start + code_size;
+            size_t next_code = 0;
+            size_t next = find_start(nal, next_code);
+            size_t end = next;
+            while (end > nal && data[end - 1] == 0 && next < size) --end; // trailing_zero_8bits
+            if (end > nal) fn(data + nal, end - nal);
+            start = next;
+            code_size = next_code;
+        }
+    }
+
+    /*
+     * Access unit -> RTP packets, the counterpart of Depacketizer.
+     *
+     * input() takes one Annex-B access unit and calls the packet callback for every RTP packet, the marker
+     * bit is set on the last packet of the frame. Consecutive NAL units that fit the MTU together go out
+     * as one aggregation packet (STAP-A / AP), so parameter sets and SEI no longer cost a packet each,
+     * larger ones are fragmented (FU-A / FU). The packet pointer is only valid inside the callback.
+     *
+     * Audio packetizers take one frame per input() and may hold it back to share a packet with the next
+     * frames, call flush() when the stream pauses or ends.
+     */
+    class Packetizer {
+    public:
+        using PacketCallback = std::function<void(const uint8_t *packet, size_t size)>;
+
+        explicit Packetizer(const PacketizerConfig &config) : config_(config) {
+            if (config_.mtu > RTP_MAX_PACKET_SIZE) config_.mtu = RTP_MAX_PACKET_SIZE;
+            if (config_.mtu < RTP_HEADER_SIZE + 64) config_.mtu = RTP_HEADER_SIZE + 64;
+            // 15 is reserved and would not fit the 4-bit id, sending it would end the extension block early
+            if (config_.abs_capture_time_id > 14) config_.abs_capture_time_id = 0;
+            if (config_.ssrc == 0) config_.ssrc = rtp_random32();
+            seq_ = static_cast<uint16_t>(rtp_random32());
+        }
+
+        virtual ~Packetizer() = default;
+
+        Packetizer(const Packetizer &) = delete;
+
+        Packetizer &operator=(const Packetizer &) = delete;
+
+        virtual void input(const uint8_t *data, size_t size, uint32_t rtp_timestamp) = 0;
+
+        /// Send whatever is held back for aggregation
+        virtual void flush() {}
+
+        /// Fill the fmtp/ptime/extmap attributes this packetization needs
+        virtual void describe(SdpMedia &media) const {
+            media.payload_type = config_.payload_type;
+            if (config_.abs_capture_time_id != 0) media.extmap[config_.abs_capture_time_id] = ABS_CAPTURE_TIME_URI;
+        }
+
+        void set_packet_callback(PacketCallback cb) { callback_ = std::move(cb); }
+
+        /// Capture time (NTP, see ntp_from_unix_us) of the next input, carried in abs-capture-time and measured
+        /// into the latency histogram. Aggregated audio keeps the time of the first frame in the packet.
+        void set_capture_time(uint64_t ntp) {
+            if (capture_ntp_ == 0) capture_ntp_ = ntp;
+        }
+
+        /// Capture-to-send delay, recorded once per packet that carries a capture time
+        void set_latency_histogram(std::shared_ptr<LatencyHistogram> histogram) { latency_ = std::move(histogram); }
+
+        [[nodiscard]] const PacketizerConfig &config() const { return config_; }
+
+        [[nodiscard]] uint16_t next_seq() const { return seq_; }
+
+        [[nodiscard]] uint64_t num_packets() const { return num_packets_; }
+
+        [[nodiscard]] uint64_t num_bytes() const { return num_bytes_; }
+
+        /// nullptr for an unsupported codec or an abs_capture_time_id outside 1..14
+        static std::unique_ptr<Packetizer> create(const PacketizerConfig &config);
+
+    protected:
+        [[nodiscard]] size_t max_payload() const {
+            return config_.mtu - RTP_HEADER_SIZE - (config_.abs_capture_time_id != 0 ? ABS_CAPTURE_TIME_SIZE : 0);
+        }
+
+        /// Start a packet in packet_, payload is appended with add()
+        void begin(uint32_t rtp_timestamp) {
+            packet_[0] = 0x80;
+            packet_[1] = config_.payload_type & 0x7F;
+            write_be16(packet_ + 2, seq_);
+            write_be32(packet_ + 4, rtp_timestamp);
+            write_be32(packet_ + 8, config_.ssrc);
+            size_ = RTP_HEADER_SIZE;
+
+            // the first packet of a frame carries its capture time
+            packet_capture_ntp_ = capture_ntp_;
+            capture_ntp_ = 0;
+            if (packet_capture_ntp_ != 0 && config_.abs_capture_time_id != 0) {
+                uint8_t *ext = packet_ + RTP_HEADER_SIZE;
+                packet_[0] |= 0x10;
+                write_be16(ext, 0xBEDE);
+                write_be16(ext + 2, 3); // words
+                ext[4] = static_cast<uint8_t>(config_.abs_capture_time_id << 4 | 7); // 8 bytes
+                write_be32(ext + 5, static_cast<uint32_t>(packet_capture_ntp_ >> 32));
+                write_be32(ext + 9, static_cast<uint32_t>(packet_capture_ntp_));
+                ext[13] = ext[14] = ext[15] = 0; // padding
+                size_ += ABS_CAPTURE_TIME_SIZE;
+            }
+        }
+
+        void add(const uint8_t *data, size_t size) {
+            std::memcpy(packet_ + size_, data, size);
+            size_ += size;
+        }
+
+        void add_byte(uint8_t value) { packet_[size_++] = value; }
+
+        void send(bool marker) {
+            if (marker) packet_[1] |= 0x80;
+            ++seq_;
+            ++num_packets_;
+            num_bytes_ += size_;
+            if (callback_) callback_(packet_, size_);
+            if (latency_ && packet_capture_ntp_ != 0) {
+                latency_->record_since(packet_capture_ntp_);
+                packet_capture_ntp_ = 0;
+            }
+        }
+
+    protected:
+        PacketizerConfig config_;
+        PacketCallback callback_{};
+
+        uint8_t packet_[RTP_MAX_PACKET_SIZE]{};
+        size_t size_{0};
+        uint16_t seq_{0};
+
+        uint64_t num_packets_{0};
+        uint64_t num_bytes_{0};
+
+        uint64_t capture_ntp_{0}; // for the next begin()
+        uint64_t packet_capture_ntp_{0};
+        std::shared_ptr<LatencyHistogram> latency_{};
+
+    private:
+        static constexpr size_t ABS_CAPTURE_TIME_SIZE = 16; // extension header 4 + element 9 + padding 3
+    };
+
+    /*
+     * Shared H.264/H.265 logic, they only differ in the NAL header size and the aggregation/fragment headers.
+     * NAL units of one access unit are collected first so the last packet can carry the marker.
+     */
+    class VideoPacketizer : public Packetizer {
+    public:
+        explicit VideoPacketizer(const PacketizerConfig &config, size_t nal_header_size)
+                : Packetizer(config), nal_header_size_(nal_header_size) {
+        }
+
+        void input(const uint8_t *data, size_t size, uint32_t rtp_timestamp) override {
+            nals_.clear();
+            for_each_annexb_nal(data, size, [this](const uint8_t *nal, size_t nal_size) {
+                if (nal_size > nal_header_size_) nals_.push_back({nal, nal_size});
+            });
+
+            const size_t limit = max_payload();
+            size_t i = 0;
+            while (i < nals_.size()) {
+                const Nal &nal = nals_[i];
+                if (nal.size > limit) {
+                    fragment(nal, rtp_timestamp, i + 1 == nals_.size());
+                    ++i;
+                    continue;
+                }
+
+                // greedy: take following NAL units while the aggregation packet still fits
+                size_t count = 1;
+                size_t total = nal_header_size_ + 2 + nal.size;
+                while (config_.aggregate && i + count < nals_.size()) {
+                    const size_t next = total + 2 + nals_[i + count].size;
+                    if (next > limit) break;
+                    total = next;
+                    ++count;
+                }
+
+                begin(rtp_timestamp);
+                if (count == 1) {
+                    add(nal.data, nal.size);
+                } else {
+                    aggregation_header(&nals_[i], count);
+                    for (size_t k = 0; k < count; ++k) {
+                        add_byte(static_cast<uint8_t>(nals_[i + k].size >> 8));
+                        add_byte(static_cast<uint8_t>(nals_[i + k].size));
+                        add(nals_[i + k].data, nals_[i + k].size);
+                    }
+                }
+                i += count;
+                send(i == nals_.size());
+            }
+        }
+
+    protected:
+        struct Nal {
+            const uint8_t *data;
+            size_t size;
+        };
+
+        virtual void aggregation_header(const Nal *nals, size_t count) = 0;
+
+        /// Write the fragment unit indicator/header for one fragment
+        virtual void fragment_header(const uint8_t *nal, bool start, bool end) = 0;
+
+        void fragment(const Nal &nal, uint32_t rtp_timestamp, bool last_nal) {
+            const size_t chunk = max_payload() - nal_header_size_ - 1;
+            size_t offset = nal_header_size_;
+            while (offset < nal.size) {
+                const size_t size = std::min(chunk, nal.size - offset);
+                const bool start = offset == nal_header_size_;
+                const bool end = offset + size == nal.size;
+                begin(rtp_timestamp);
+                fragment_header(nal.data, start, end);
+                add(nal.data + offset, size);
+                offset += size;
+                send(end && last_nal);
+            }
+        }
+
+    protected:
+        size_t nal_header_size_;
+        std::vector<Nal> nals_{};
+    };
+
+    /// RFC 6184 packetization-mode=1: single NAL, STAP-A (24), FU-A (28)
+    class H264Packetizer : public VideoPacketizer {
+    public:
+        explicit H264Packetizer(const PacketizerConfig &config) : VideoPacketizer(config, 1) {
+        }
+
+        void describe(SdpMedia &media) const override {
+            Packetizer::describe(media);
+            media.fmtp["packetization-mode"] = "1";
+        }
+
+    protected:
+        void aggregation_header(const Nal *nals, size_t count) override {
+            uint8_t f = 0, nri = 0;
+            for (size_t i = 0; i < count; ++i) {
+                f |= nals[i].data[0] & 0x80;
+                nri = std::max<uint8_t>(nri, nals[i].data[0] & 0x60);
+            }
+            add_byte(static_cast<uint8_t>(f | nri | 24));
+        }
+
+        void fragment_header(const uint8_t *nal, bool start, bool end) override {
+            add_byte(static_cast<uint8_t>((nal[0] & 0xE0) | 28));
+            add_byte(static_cast<uint8_t>((start ? 0x80 : 0) | (end ? 0x40 : 0) | (nal[0] & 0x1F)));
+        }
+    };
+
+    /// RFC 7798: single NAL, AP (48), FU (49)
+    class H265Packetizer : public VideoPacketizer {
+    public:
+        explicit H265Packetizer(const PacketizerConfig &config) : VideoPacketizer(config, 2) {
+        }
+
+    protected:
+        void aggregation_header(const Nal *nals, size_t count) override {
+            // F bit OR-ed, LayerId and TID the lowest of the aggregated units
+            uint8_t f = 0, layer = 0x3F, tid = 0x07;
+            for (size_t i = 0; i < count; ++i) {
+                const uint8_t *h = nals[i].data;
+                f |= h[0] & 0x80;
+                layer = std::min<uint8_t>(layer, static_cast<uint8_t>(((h[0] & 0x01) << 5) | (h[1] >> 3)));
+                tid = std::min<uint8_t>(tid, h[1] & 0x07);
+            }
+            add_byte(static_cast<uint8_t>(f | (48 << 1) | (layer >> 5)));
+            add_byte(static_cast<uint8_t>(((layer & 0x1F) << 3) | tid));
+        }
+
+        void fragment_header(const uint8_t *nal, bool start, bool end) override {
+            const uint8_t type = (nal[0] >> 1) & 0x3F;
+            add_byte(static_cast<uint8_t>((nal[0] & 0x81) | (49 << 1)));
+            add_byte(nal[1]);
+            add_byte(static_cast<uint8_t>((start ? 0x80 : 0) | (end ? 0x40 : 0) | type));
+        }
+    };
+
+    /*
+     * RFC 3640 mpeg4-generic AAC-hbr: up to aac_frames AUs per packet behind one AU-headers section
+     * (13-bit size, 3-bit index), an AU larger than the MTU is fragmented. Input may be ADTS or raw.
+     */
+    class AACPacketizer : public Packetizer {
+    public:
+        explicit AACPacketizer(const PacketizerConfig &config) : Packetizer(config) {
+            if (config_.aac_frames == 0) config_.aac_frames = 1;
+            if (config_.aac_frames > MAX_FRAMES) config_.aac_frames = MAX_FRAMES;
+        }
+
+        void input(const uint8_t *data, size_t size, uint32_t rtp_timestamp) override {
+            if (size >= 7 && data[0] == 0xFF && (data[1] & 0xF0) == 0xF0) {
+                const size_t header = (data[1] & 0x01) ? 7 : 9; // protection_absent
+                if (size <= header) return;
+                data += header;
+                size -= header;
+            }
+            if (size == 0 || size > 0x1FFF) return;
+
+            // only contiguous frames share a packet, a gap in timestamps starts a new one
+            if (num_frames_ != 0 && rtp_timestamp != first_ts_ + num_frames_ * 1024) flush();
+            if (num_frames_ != 0 && 2 + (num_frames_ + 1) * 2 + data_.size() + size > max_payload()) flush();
+
+            if (2 + 2 + size > max_payload()) {
+                fragment(data, size, rtp_timestamp);
+                return;
+            }
+
+            if (num_frames_ == 0) first_ts_ = rtp_timestamp;
+            sizes_[num_frames_++] = static_cast<uint16_t>(size);
+            data_.insert(data_.end(), data, data + size);
+            if (num_frames_ >= config_.aac_frames) flush();
+        }
+
+        void flush() override {
+            if (num_frames_ == 0) return;
+
+            begin(first_ts_);
+            add_au_headers(sizes_, num_frames_);
+            add(data_.data(), data_.size());
+            send(true);
+
+            num_frames_ = 0;
+            data_.clear();
+        }
+
+        void describe(SdpMedia &media) const override {
+            Packetizer::describe(media);
+            media.clock_rate = config_.sample_rate;
+            media.channels = config_.channels;
+
+            // AudioSpecificConfig: object type (5) | frequency index (4) | channel configuration (4) | 000
+            const auto asc = static_cast<uint16_t>(
+                    (config_.aac_object_type << 11) | (aac_frequency_index(config_.sample_rate) << 7) |
+                    ((config_.channels & 0x0F) << 3)
+            );
+            char hex[5];
+            std::snprintf(hex, sizeof(hex), "%04X", asc);
+
+            media.fmtp["streamtype"] = "5";
+            media.fmtp["profile-level-id"] = "1";
+            media.fmtp["mode"] = "AAC-hbr";
+            media.fmtp["sizelength"] = "13";
+            media.fmtp["indexlength"] = "3";
+            media.fmtp["indexdeltalength"] = "3";
+            media.fmtp["config"] = hex;
+            if (config_.aac_frames > 1) {
+                media.ptime = static_cast<uint32_t>(config_.aac_frames * 1024 * 1000 / config_.sample_rate);
+            }
+        }
+
+    private:
+        static constexpr uint32_t MAX_FRAMES = 32;
+
+        void add_au_headers(const uint16_t *sizes, size_t count) {
+            const auto bits = static_cast<uint16_t>(count * 16);
+            add_byte(static_cast<uint8_t>(bits >> 8));
+            add_byte(static_cast<uint8_t>(bits));
+            for (size_t i = 0; i < count; ++i) {
+                add_byte(static_cast<uint8_t>(sizes[i] >> 5)); // size (13) | index/index-delta 0 (3)
+                add_byte(static_cast<uint8_t>(sizes[i] << 3));
+            }
+        }
+
+        void fragment(const uint8_t *data, size_t size, uint32_t rtp_timestamp) {
+            const auto au_size = static_cast<uint16_t>(size);
+            const size_t chunk = max_payload() - 4;
+            for (size_t offset = 0; offset < size; offset += chunk) {
+                const size_t n = std::min(chunk, size - offset);
+                begin(rtp_timestamp);
+                add_au_headers(&au_size, 1);
+                add(data + offset, n);
+                send(offset + n == size);
+            }
+        }
+
+    private:
+        uint16_t sizes_[MAX_FRAMES]{};
+        uint32_t num_frames_{0};
+        uint32_t first_ts_{0};
+        std::vector<uint8_t> data_{};
+    };
+
+    /// G.711A raw samples (8 kHz), input frames are concatenated until ptime_ms worth of samples
+    class G711APacketizer : public Packetizer {
+    public:
+        explicit G711APacketizer(const PacketizerConfig &config) : Packetizer(config) {
+            if (config_.ptime_ms == 0) config_.ptime_ms = 20;
+            target_ = std::min<size_t>(config_.ptime_ms * 8, max_payload());
+        }
+
+        void input(const uint8_t *data, size_t size, uint32_t rtp_timestamp) override {
+            if (!data_.empty() && rtp_timestamp != static_cast<uint32_t>(first_ts_ + data_.size())) flush();
+
+            while (size > 0) {
+                if (data_.empty()) first_ts_ = rtp_timestamp;
+                const size_t n = std::min(size, target_ - data_.size());
+                data_.insert(data_.end(), data, data + n);
+                data += n;
+                size -= n;
+                rtp_timestamp += static_cast<uint32_t>(n);
+                if (data_.size() >= target_) flush();
+            }
+        }
+
+        void flush() override {
+            if (data_.empty()) return;
+            begin(first_ts_);
+            add(data_.data(), data_.size());
+            send(false);
+            data_.clear();
+        }
+
+        void describe(SdpMedia &media) const override {
+            Packetizer::describe(media);
+            media.clock_rate = 8000;
+            media.channels = 1;
+            media.ptime = config_.ptime_ms;
+        }
+
+    private:
+        size_t target_{160};
+        uint32_t first_ts_{0};
+        std::vector<uint8_t> data_{};
+    };
+
+    inline std::unique_ptr<Packetizer> Packetizer::create(const PacketizerConfig &config) {
+        if (config.abs_capture_time_id > 14) return nullptr;
+        switch (config.codec) {
+            case H264:
+                return std::make_unique<H264Packetizer>(config);
+            case H265:
+                return std::make_unique<H265Packetizer>(config);
+            case AAC:
+                return std::make_unique<AACPacketizer>(config);
+            case PCMA:
+                return std::make_unique<G711APacketizer>(config);
+            default:
+                return nullptr;
+        }
+    }
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <ctime>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+
+namespace rtspx {
+    static constexpr size_t RTP_HEADER_SIZE = 12;
+    static constexpr size_t RTP_TCP_HEAD_SIZE = 4; // '$' + channel + 16-bit length
+    static constexpr size_t RTP_MAX_PACKET_SIZE = 1500;
+
+    /// Parsed view over a received RTP packet, payload points into the caller's buffer
+    struct RtpHeaderView {
+        uint8_t version{};
+        bool padding{};
+        bool extension{};
+        bool marker{};
+        uint8_t csrc_count{};
+        uint8_t payload_type{};
+        uint16_t seq{};
+        uint32_t timestamp{};
+        uint32_t ssrc{};
+        const uint8_t *payload{nullptr};
+        size_t payload_size{};
+        uint16_t extension_profile{}; // 0xBEDE one-byte, 0x100x two-byte RFC 8285 headers
+        const uint8_t *extension_data{nullptr};
+        size_t extension_size{};
+    };
+
+    /// RFC 8285 extension URI of the absolute capture time (64-bit NTP timestamp of the capture)
+    static constexpr const char *ABS_CAPTURE_TIME_URI = "http://www.webrtc.org/experiments/rtp-hdrext/abs-capture-time";
+
+    /// Seconds between the NTP epoch (1900) and the Unix epoch
+    static constexpr uint64_t NTP_UNIX_OFFSET = 2208988800ULL;
+
+    /// Random SSRC / initial sequence number / timestamp offset (RFC 3550 5.1, 8.1)
+    static inline uint32_t rtp_random32() {
+        static thread_local std::mt19937 rng(std::random_device{}());
+        return static_cast<uint32_t>(rng());
+    }
+
+    static inline uint16_t read_be16(const uint8_t *p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    static inline uint32_t read_be32(const uint8_t *p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    static inline void write_be16(uint8_t *p, uint16_t v) {
+        p[0] = static_cast<uint8_t>(v >> 8);
+        p[1] = static_cast<uint8_t>(v);
+    }
+
+    static inline void write_be32(uint8_t *p, uint32_t v) {
+        p[0] = static_cast<uint8_t>(v >> 24);
+        p[1] = static_cast<uint8_t>(v >> 16);
+        p[2] = static_cast<uint8_t>(v >> 8);
+        p[3] = static_cast<uint8_t>(v);
+    }
+
+    /// RTCP SR/RR/SDES/BYE/APP share the RTP port in rtcp-mux and interleaved odd channels
+    static inline bool is_rtcp_packet(const uint8_t *data, size_t size) {
+        return size >= 2 && (data[0] >> 6) == 2 && data[1] >= 200 && data[1] <= 204;
+    }
+
+    static inline bool parse_rtp_header(const uint8_t *data, size_t size, RtpHeaderView &rtp) {
+        if (data == nullptr || size < RTP_HEADER_SIZE) return false;
+
+        rtp.version = data[0] >> 6;
+        if (rtp.version != 2) return false;
+
+        rtp.padding = (data[0] & 0x20) != 0;
+        rtp.extension = (data[0] & 0x10) != 0;
+        rtp.csrc_count = data[0] & 0x0F;
+        rtp.marker = (data[1] & 0x80) != 0;
+        rtp.payload_type = data[1] & 0x7F;
+        rtp.seq = read_be16(data + 2);
+        rtp.timestamp = read_be32(data + 4);
+        rtp.ssrc = read_be32(data + 8);
+
+        size_t offset = RTP_HEADER_SIZE + rtp.csrc_count * 4u;
+        if (offset > size) return false;
+
+        if (rtp.extension) {
+            if (offset + 4 > size) return false;
+            rtp.extension_profile = read_be16(data + offset);
+            rtp.extension_size = read_be16(data + offset + 2) * 4u;
+            rtp.extension_data = data + offset + 4;
+            offset += 4 + rtp.extension_size;
+            if (offset > size) return false;
+        }
+
+        size_t end = size;
+        if (rtp.padding) {
+            const uint8_t pad = data[size - 1];
+            if (pad == 0 || offset + pad > size) return false;
+            end -= pad;
+        }
+
+        rtp.payload = data + offset;
+        rtp.payload_size = end - offset;
+        return true;
+    }
+
+    /// Find extension element id in a one-byte or two-byte RFC 8285 header block
+    static inline bool find_rtp_extension(const RtpHeaderView &rtp, uint8_t id, const uint8_t *&data, size_t &size) {
+        if (rtp.extension_data == nullptr || id == 0) return false;
+        const bool one_byte = rtp.extension_profile == 0xBEDE;
+        if (!one_byte && (rtp.extension_profile & 0xFFF0) != 0x1000) return false;
+
+        const uint8_t *p = rtp.extension_data;
+        const uint8_t *end = p + rtp.extension_size;
+        while (p < end) {
+            if (*p == 0) { // padding
+                ++p;
+                continue;
+            }
+            uint8_t element_id;
+            size_t length;
+            if (one_byte) {
+                element_id = *p >> 4;
+                length = (*p & 0x0F) + 1u;
+                if (element_id == 15) return false; // reserved, stop parsing
+                ++p;
+            } else {
+                if (p + 2 > end) return false;
+                element_id = p[0];
+                length = p[1];
+                p += 2;
+            }
+            if (p + length > end) return false;
+            if (element_id == id) {
+                data = p;
+                size = length;
+                return true;
+            }
+            p += length;
+        }
+        return false;
+    }
+
+    static inline uint64_t ntp_from_unix_us(int64_t unix_us) {
+        const auto us = static_cast<uint64_t>(unix_us);
+        const uint64_t seconds = us / 1000000 + NTP_UNIX_OFFSET;
+        const uint64_t fraction = ((us % 1000000) << 32) / 1000000;
+        return seconds << 32 | fraction;
+    }
+
+    static inline int64_t ntp_to_unix_us(uint64_t ntp) {
+        const uint64_t seconds = (ntp >> 32) - NTP_UNIX_OFFSET;
+        const uint64_t us = ((ntp & 0xFFFFFFFFULL) * 1000000) >> 32;
+        return static_cast<int64_t>(seconds * 1000000 + us);
+    }
+
+    /// Wall clock as 64-bit NTP, the clock abs-capture-time is expressed in
+    static inline uint64_t ntp_now() {
+        timespec ts{};
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return ntp_from_unix_us(static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+    }
+
+    /// abs-capture-time element (8 bytes, or 16 with the clock offset) of a received packet
+    static inline bool read_abs_capture_time(const RtpHeaderView &rtp, uint8_t id, uint64_t &ntp) {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+        if (!find_rtp_extension(rtp, id, data, size) || size < 8) return false;
+        ntp = static_cast<uint64_t>(read_be32(data)) << 32 | read_be32(data + 4);
+        return true;
+    }
+
+    /// Signed distance between two 16-bit sequence numbers, positive when b is after a
+    static inline int16_t rtp_seq_diff(uint16_t a, uint16_t b) {
+        return static_cast<int16_t>(static_cast<uint16_t>(b - a));
+    }
+}
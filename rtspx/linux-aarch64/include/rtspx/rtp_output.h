@@ -0,0 +1,213 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "rtspx/sdp.h"
+#include "rtspx/xdp.h"
+#include "rtspx/types.h"
+#include "rtspx/latency.h"
+#include "rtspx/packetizer.h"
+
+namespace rtspx {
+    struct RtpOutputConfig {
+        PacketizerConfig video{}; // codec NONE = no video track
+        PacketizerConfig audio{}; // codec NONE = no audio track
+        uint32_t video_pts_rate{1000}; // pts units per second of the pushed frames, 1000 = ms
+        uint32_t audio_pts_rate{1000};
+        std::string bind_ip{};
+        uint16_t bind_port{0}; // source port of both tracks, 0 = any
+        net::XdpConfig xdp{}; // with an ifname the packets go through AF_XDP when possible (experimental)
+    };
+
+    /*
+     * Plain RTP over UDP egress, what `ffmpeg -f rtp` does: for receivers that take an SDP file and a fixed
+     * unicast/multicast address instead of an RTSP session.
+     *
+     * Frames are packetized (Packetizer, STAP-A/AP and aggregated audio), sent through RtpUdpSender to every
+     * destination (AF_XDP when enabled and resolved, the kernel socket otherwise) and the capture-to-send delay
+     * of each frame goes into latency(). RTP timestamps are derived from pts with a random offset; audio
+     * timestamps that are off by less than half a frame (millisecond pts) are snapped onto the sample count,
+     * so consecutive frames still share a packet. sdp() describes the output for a receiver.
+     *
+     * push_data() takes the same EncodedShared frames as MediaSession::push_data and is thread-safe, packets
+     * go out on the calling thread. Call flush() when audio pauses, aggregated frames are held back until then.
+     */
+    class RtpUdpOutput {
+    public:
+        explicit RtpUdpOutput(const RtpOutputConfig &config) : config_(config) {
+        }
+
+        ~RtpUdpOutput() { close(); }
+
+        RtpUdpOutput(const RtpUdpOutput &) = delete;
+
+        RtpUdpOutput &operator=(const RtpUdpOutput &) = delete;
+
+        /// false when the socket cannot be bound or a track config is invalid
+        bool open() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (sender_.fd() >= 0) return false;
+            if (!open_track(video_, config_.video, Video, config_.video_pts_rate) ||
+                !open_track(audio_, config_.audio, Audio, config_.audio_pts_rate) ||
+                (!video_.packetizer && !audio_.packetizer) || !sender_.open(config_.bind_ip, config_.bind_port)) {
+                reset();
+                return false;
+            }
+            if (!config_.xdp.ifname.empty()) sender_.enable_xdp(config_.xdp); // the kernel path stays otherwise
+            return true;
+        }
+
+        void close() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            reset();
+        }
+
+        /// Send the video to ip:video_port and the audio to ip:audio_port, a port of 0 skips that track
+        bool add_destination(const std::string &ip, uint16_t video_port, uint16_t audio_port) {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            if (::inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) return false;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (video_port != 0 && video_.packetizer) {
+                addr.sin_port = htons(video_port);
+                video_.destinations.push_back(addr);
+            }
+            if (audio_port != 0 && audio_.packetizer) {
+                addr.sin_port = htons(audio_port);
+                audio_.destinations.push_back(addr);
+            }
+            return true;
+        }
+
+        void clear_destinations() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            video_.destinations.clear();
+            audio_.destinations.clear();
+        }
+
+        /// capture_ntp: capture time of the frame (ntp_from_unix_us), 0 takes the time of the call
+        bool push_data(MediaTrack track, const EncodedShared &frame, uint64_t capture_ntp = 0) {
+            if (frame.data == nullptr || frame.size == 0) return false;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            Track &t = track == Video ? video_ : audio_;
+            if (!t.packetizer || sender_.fd() < 0) return false;
+
+            t.packetizer->set_capture_time(capture_ntp != 0 ? capture_ntp : ntp_now());
+            t.packetizer->input(frame.data, frame.size, rtp_timestamp(t, frame));
+            sender_.flush();
+            return true;
+        }
+
+        /// Send audio held back for aggregation
+        void flush() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (audio_.packetizer) audio_.packetizer->flush();
+            sender_.flush();
+        }
+
+        /// Session description for a receiver listening on ip with these ports
+        [[nodiscard]] std::string sdp(const std::string &ip, uint16_t video_port, uint16_t audio_port) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::string out = "v=0\r\no=- 0 0 IN IP4 " + ip + "\r\ns=rtspx\r\nc=IN IP4 " + ip + "\r\nt=0 0\r\n";
+            if (video_.packetizer && video_port != 0) out += build_sdp_media(describe(video_, video_port));
+            if (audio_.packetizer && audio_port != 0) out += build_sdp_media(describe(audio_, audio_port));
+            return out;
+        }
+
+        /// Capture-to-send delay of the frames (the first packet of each)
+        [[nodiscard]] const std::shared_ptr<LatencyHistogram> &latency() const { return latency_; }
+
+        [[nodiscard]] uint16_t port() const { return sender_.port(); }
+
+        [[nodiscard]] bool is_xdp() const { return sender_.is_xdp(); }
+
+        [[nodiscard]] uint64_t num_packets() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return (video_.packetizer ? video_.packetizer->num_packets() : 0) +
+                   (audio_.packetizer ? audio_.packetizer->num_packets() : 0);
+        }
+
+        static std::shared_ptr<RtpUdpOutput> create(const RtpOutputConfig &config) {
+            auto output = std::make_shared<RtpUdpOutput>(config);
+            return output->open() ? output : nullptr;
+        }
+
+    private:
+        struct Track {
+            MediaTrack track{Video};
+            std::unique_ptr<Packetizer> packetizer;
+            std::vector<sockaddr_in> destinations;
+            uint32_t clock_rate{90000};
+            uint32_t pts_rate{1000};
+            uint32_t offset{0}; // random start of the RTP timestamps
+            uint32_t next{0}; // expected timestamp of the next audio frame
+            bool has_next{false};
+        };
+
+        bool open_track(Track &t, const PacketizerConfig &config, MediaTrack track, uint32_t pts_rate) {
+            t = Track{};
+            t.track = track;
+            if (config.codec == NONE) return true;
+            t.packetizer = Packetizer::create(config);
+            if (!t.packetizer) return false;
+
+            SdpMedia media;
+            t.packetizer->describe(media);
+            t.clock_rate = media.clock_rate;
+            t.pts_rate = pts_rate == 0 ? 1000 : pts_rate;
+            t.offset = rtp_random32();
+            t.packetizer->set_latency_histogram(latency_);
+            Track *self = &t;
+            t.packetizer->set_packet_callback([this, self](const uint8_t *packet, size_t size) {
+                for (const auto &dst: self->destinations) sender_.send(dst, packet, size);
+            });
+            return true;
+        }
+
+        void reset() {
+            video_ = Track{};
+            audio_ = Track{};
+            sender_.close();
+        }
+
+        static uint32_t rtp_timestamp(Track &t, const EncodedShared &frame) {
+            auto ts = static_cast<uint32_t>(frame.pts * t.clock_rate / t.pts_rate) + t.offset;
+            if (t.track != Audio) return ts;
+
+            const uint32_t samples = t.packetizer->config().codec == AAC ? 1024 : static_cast<uint32_t>(frame.size);
+            if (t.has_next && static_cast<uint32_t>(std::abs(static_cast<int32_t>(ts - t.next))) < samples / 2) {
+                ts = t.next;
+            }
+            t.next = ts + samples;
+            t.has_next = true;
+            return ts;
+        }
+
+        static SdpMedia describe(const Track &t, uint16_t port) {
+            SdpMedia media;
+            media.track = t.track;
+            media.codec = t.packetizer->config().codec;
+            media.port = port;
+            t.packetizer->describe(media);
+            return media;
+        }
+
+    private:
+        RtpOutputConfig config_;
+        std::shared_ptr<LatencyHistogram> latency_{std::make_shared<LatencyHistogram>()};
+
+        mutable std::mutex mutex_;
+        net::RtpUdpSender sender_;
+        Track video_;
+        Track audio_;
+    };
+}
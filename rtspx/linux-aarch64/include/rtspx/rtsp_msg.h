@@ -0,0 +1,254 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <strings.h>
+
+namespace rtspx {
+    /// One RTSP request or response, used by the header-only ingest/pull side (relay, client)
+    struct RtspMsg {
+        bool response{false};
+        std::string method{};
+        std::string url{};
+        std::string version{"RTSP/1.0"};
+        int status{0};
+        std::string reason{};
+        std::vector<std::pair<std::string, std::string> > headers{};
+        std::string body{};
+
+        [[nodiscard]] std::string header(const char *name) const {
+            for (const auto &kv: headers) {
+                if (strcasecmp(kv.first.c_str(), name) == 0) return kv.second;
+            }
+            return {};
+        }
+
+        [[nodiscard]] int cseq() const {
+            const std::string value = header("CSeq");
+            return value.empty() ? -1 : std::atoi(value.c_str());
+        }
+
+        /// Session header without the ";timeout=" part
+        [[nodiscard]] std::string session() const {
+            const std::string value = header("Session");
+            return value.substr(0, value.find(';'));
+        }
+    };
+
+    struct RtspTransport {
+        bool tcp{false};
+        bool multicast{false};
+        int interleaved[2]{-1, -1};
+        uint16_t client_port[2]{0, 0};
+        uint16_t server_port[2]{0, 0};
+    };
+
+    struct RtspUrl {
+        std::string host{};
+        uint16_t port{554};
+        std::string path{}; // without leading '/'
+        std::string username{};
+        std::string password{};
+    };
+
+    /*
+     * Parse one message from the front of data.
+     * Returns the number of bytes consumed, 0 when more data is needed, -1 when the data is not RTSP.
+     */
+    static inline int parse_rtsp_msg(const char *data, size_t size, RtspMsg &msg, size_t max_size = 64 * 1024) {
+        const char *end = nullptr;
+        for (size_t i = 0; i + 3 < size; ++i) {
+            if (data[i] == '\r' && data[i + 1] == '\n' && data[i + 2] == '\r' && data[i + 3] == '\n') {
+                end = data + i;
+                break;
+            }
+        }
+        if (end == nullptr) return size > max_size ? -1 : 0;
+
+        msg = RtspMsg();
+        const char *line = data;
+        const char *eol = static_cast<const char *>(std::memchr(line, '\r', end - line + 1));
+        std::string first(line, eol);
+
+        if (first.compare(0, 5, "RTSP/") == 0) {
+            // RTSP/1.0 200 OK
+            msg.response = true;
+            const size_t sp1 = first.find(' ');
+            if (sp1 == std::string::npos) return -1;
+            const size_t sp2 = first.find(' ', sp1 + 1);
+            msg.version = first.substr(0, sp1);
+            msg.status = std::atoi(first.c_str() + sp1 + 1);
+            msg.reason = sp2 == std::string::npos ? std::string() : first.substr(sp2 + 1);
+        } else {
+            // METHOD url RTSP/1.0
+            const size_t sp1 = first.find(' ');
+            const size_t sp2 = first.rfind(' ');
+            if (sp1 == std::string::npos || sp2 == sp1) return -1;
+            msg.method = first.substr(0, sp1);
+            msg.url = first.substr(sp1 + 1, sp2 - sp1 - 1);
+            msg.version = first.substr(sp2 + 1);
+            if (msg.version.compare(0, 5, "RTSP/") != 0) return -1;
+        }
+
+        line = eol + 2;
+        while (line < end) {
+            eol = static_cast<const char *>(std::memchr(line, '\r', end - line + 1));
+            const char *colon = static_cast<const char *>(std::memchr(line, ':', eol - line));
+            if (colon != nullptr) {
+                const char *value = colon + 1;
+                while (value < eol && *value == ' ') ++value;
+                msg.headers.emplace_back(std::string(line, colon), std::string(value, eol));
+            }
+            line = eol + 2;
+        }
+
+        const size_t head_size = end - data + 4;
+        const std::string length = msg.header("Content-Length");
+        const size_t body_size = length.empty() ? 0 : std::strtoul(length.c_str(), nullptr, 10);
+        if (body_size > max_size) return -1;
+        if (head_size + body_size > size) return 0;
+
+        msg.body.assign(data + head_size, body_size);
+        return static_cast<int>(head_size + body_size);
+    }
+
+    /*
+     * Split the front of an RTSP TCP stream into interleaved frames ('$' channel length payload) and messages.
+     * on_frame(channel, data, size) and on_message(msg) return false to stop, e.g. after the connection closed.
+     * Returns the number of bytes consumed, -1 when the stream is not RTSP.
+     */
+    template<typename OnFrame, typename OnMessage>
+    static inline long consume_rtsp_stream(const char *data, size_t size, OnFrame &&on_frame, OnMessage &&on_message) {
+        size_t offset = 0;
+        while (offset < size) {
+            const char *p = data + offset;
+            const size_t left = size - offset;
+
+            if (p[0] == '$') {
+                if (left < 4) break;
+                const auto *head = reinterpret_cast<const uint8_t *>(p);
+                const size_t length = (static_cast<size_t>(head[2]) << 8) | head[3];
+                if (left < 4 + length) break;
+                offset += 4 + length;
+                if (!on_frame(head[1], head + 4, length)) break;
+                continue;
+            }
+
+            RtspMsg msg;
+            const int consumed = parse_rtsp_msg(p, left, msg);
+            if (consumed < 0) return -1;
+            if (consumed == 0) break;
+            offset += consumed;
+            if (!on_message(msg)) break;
+        }
+        return static_cast<long>(offset);
+    }
+
+    static inline RtspTransport parse_rtsp_transport(const std::string &value) {
+        RtspTransport transport;
+        transport.tcp = value.find("RTP/AVP/TCP") != std::string::npos;
+        transport.multicast = value.find("multicast") != std::string::npos;
+
+        auto read_pair = [&value](const char *key, long &first, long &second) {
+            const size_t pos = value.find(key);
+            if (pos == std::string::npos) return false;
+            char *next = nullptr;
+            first = std::strtol(value.c_str() + pos + std::strlen(key), &next, 10);
+            second = *next == '-' ? std::strtol(next + 1, nullptr, 10) : first + 1;
+            return true;
+        };
+
+        long first = 0, second = 0;
+        if (read_pair("interleaved=", first, second)) {
+            transport.interleaved[0] = static_cast<int>(first);
+            transport.interleaved[1] = static_cast<int>(second);
+        }
+        if (read_pair("client_port=", first, second)) {
+            transport.client_port[0] = static_cast<uint16_t>(first);
+            transport.client_port[1] = static_cast<uint16_t>(second);
+        }
+        if (read_pair("server_port=", first, second)) {
+            transport.server_port[0] = static_cast<uint16_t>(first);
+            transport.server_port[1] = static_cast<uint16_t>(second);
+        }
+        return transport;
+    }
+
+    /// rtsp://[user[:pass]@]host[:port][/path]
+    static inline bool parse_rtsp_url(const std::string &url, RtspUrl &out) {
+        if (url.compare(0, 7, "rtsp://") != 0) return false;
+
+        out = RtspUrl();
+        std::string rest = url.substr(7);
+        const size_t slash = rest.find('/');
+        std::string authority = rest.substr(0, slash);
+        out.path = slash == std::string::npos ? std::string() : rest.substr(slash + 1);
+
+        const size_t at = authority.rfind('@');
+        if (at != std::string::npos) {
+            const std::string userinfo = authority.substr(0, at);
+            const size_t colon = userinfo.find(':');
+            out.username = userinfo.substr(0, colon);
+            if (colon != std::string::npos) out.password = userinfo.substr(colon + 1);
+            authority = authority.substr(at + 1);
+        }
+
+        const size_t colon = authority.rfind(':');
+        if (colon != std::string::npos) {
+            out.port = static_cast<uint16_t>(std::strtoul(authority.c_str() + colon + 1, nullptr, 10));
+            authority = authority.substr(0, colon);
+        }
+        out.host = authority;
+        return !out.host.empty() && out.port != 0;
+    }
+
+    /// Session URL suffix as RtspServer::add_session expects it: path without query and trailing '/'
+    static inline std::string rtsp_url_suffix(const std::string &url) {
+        RtspUrl parsed;
+        if (!parse_rtsp_url(url, parsed)) return {};
+        std::string suffix = parsed.path.substr(0, parsed.path.find('?'));
+        while (!suffix.empty() && suffix.back() == '/') suffix.pop_back();
+        return suffix;
+    }
+
+    /// Absolute url of a track from the SDP control attribute and the DESCRIBE base url
+    static inline std::string rtsp_control_url(const std::string &base_url, const std::string &control) {
+        if (control.empty() || control == "*") return base_url;
+        if (control.compare(0, 7, "rtsp://") == 0) return control;
+        if (!base_url.empty() && base_url.back() == '/') return base_url + control;
+        return base_url + "/" + control;
+    }
+
+    static inline std::string build_rtsp_response(
+            int status, const char *reason, int cseq,
+            const std::vector<std::pair<std::string, std::string> > &headers = {}, const std::string &body = {}
+    ) {
+        std::string out;
+        out.reserve(256 + body.size());
+        out += "RTSP/1.0 " + std::to_string(status) + " " + reason + "\r\n";
+        out += "CSeq: " + std::to_string(cseq) + "\r\n";
+        for (const auto &kv: headers) out += kv.first + ": " + kv.second + "\r\n";
+        if (!body.empty()) out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        out += "\r\n";
+        out += body;
+        return out;
+    }
+
+    static inline std::string build_rtsp_request(
+            const char *method, const std::string &url, int cseq,
+            const std::vector<std::pair<std::string, std::string> > &headers = {}, const std::string &body = {}
+    ) {
+        std::string out;
+        out.reserve(256 + body.size());
+        out += std::string(method) + " " + url + " RTSP/1.0\r\n";
+        out += "CSeq: " + std::to_string(cseq) + "\r\n";
+        for (const auto &kv: headers) out += kv.first + ": " + kv.second + "\r\n";
+        if (!body.empty()) out += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+        out += "\r\n";
+        out += body;
+        return out;
+    }
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <cstdlib>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+
+#include "rtspx/depacketizer.h"
+
+namespace rtspx {
+    struct SdpMedia {
+        MediaTrack track{Video};
+        CodecType codec{NONE};
+        std::string media{};    // "video" / "audio"
+        std::string encoding{}; // rtpmap encoding name, upper case
+        uint8_t payload_type{};
+        uint32_t clock_rate{90000};
+        uint8_t channels{1};
+        uint16_t port{};
+        std::string control{};
+        uint32_t ptime{0}; // a=ptime in ms, 0 when absent
+        std::unordered_map<std::string, std::string> fmtp{};
+        std::map<uint8_t, std::string> extmap{}; // a=extmap id -> RTP header extension URI
+
+        /// Negotiated id of an RTP header extension, 0 when absent
+        [[nodiscard]] uint8_t extmap_id(const std::string &uri) const {
+            for (const auto &kv: extmap) {
+                if (kv.second == uri) return kv.first;
+            }
+            return 0;
+        }
+
+        [[nodiscard]] DepacketizerConfig depacketizer_config() const {
+            DepacketizerConfig config;
+            config.codec = codec;
+            config.clock_rate = clock_rate;
+
+            if (codec == AAC) {
+                config.sample_rate = clock_rate;
+                config.channels = channels;
+                config.size_length = fmtp_int("sizelength", 13);
+                config.index_length = fmtp_int("indexlength", 3);
+                config.index_delta_length = fmtp_int("indexdeltalength", 3);
+
+                // AudioSpecificConfig: object type (5) | frequency index (4) | channel configuration (4)
+                const auto it = fmtp.find("config");
+                if (it != fmtp.end() && it->second.size() >= 4) {
+                    const std::string head = it->second.substr(0, 4);
+                    const auto asc = static_cast<uint16_t>(std::strtoul(head.c_str(), nullptr, 16));
+                    config.aac_object_type = static_cast<uint8_t>(asc >> 11);
+                    config.channels = static_cast<uint8_t>((asc >> 3) & 0x0F);
+                }
+            }
+            return config;
+        }
+
+        [[nodiscard]] int fmtp_int(const std::string &key, int value) const {
+            const auto it = fmtp.find(key);
+            if (it == fmtp.end() || it->second.empty()) return value;
+            return std::atoi(it->second.c_str());
+        }
+    };
+
+    static inline CodecType codec_from_encoding(const std::string &encoding) {
+        if (encoding == "H264") return H264;
+        if (encoding == "H265" || encoding == "HEVC") return H265;
+        if (encoding == "MPEG4-GENERIC") return AAC;
+        if (encoding == "PCMA") return PCMA;
+        return NONE;
+    }
+
+    static inline const char *encoding_from_codec(CodecType codec) {
+        switch (codec) {
+            case H264:
+                return "H264";
+            case H265:
+                return "H265";
+            case AAC:
+                return "MPEG4-GENERIC";
+            case PCMA:
+                return "PCMA";
+            default:
+                return "";
+        }
+    }
+
+    /// One m= section with rtpmap, fmtp (keys sorted), ptime, extmap and control, the counterpart of parse_sdp
+    static inline std::string build_sdp_media(const SdpMedia &media) {
+        const std::string pt = std::to_string(media.payload_type);
+        const std::string kind = media.media.empty() ? (media.track == Audio ? "audio" : "video") : media.media;
+        const std::string encoding = media.encoding.empty() ? encoding_from_codec(media.codec) : media.encoding;
+
+        std::string out = "m=" + kind + " " + std::to_string(media.port) + " RTP/AVP " + pt + "\r\n";
+        out += "a=rtpmap:" + pt + " " + encoding + "/" + std::to_string(media.clock_rate);
+        if (media.track == Audio && media.channels > 1) out += "/" + std::to_string(media.channels);
+        out += "\r\n";
+
+        if (!media.fmtp.empty()) {
+            std::vector<std::pair<std::string, std::string> > params(media.fmtp.begin(), media.fmtp.end());
+            std::sort(params.begin(), params.end());
+            out += "a=fmtp:" + pt + " ";
+            for (size_t i = 0; i < params.size(); ++i) {
+                if (i != 0) out += ";";
+                out += params[i].first + "=" + params[i].second;
+            }
+            out += "\r\n";
+        }
+        if (media.ptime != 0) out += "a=ptime:" + std::to_string(media.ptime) + "\r\n";
+        for (const auto &kv: media.extmap) out += "a=extmap:" + std::to_string(kv.first) + " " + kv.second + "\r\n";
+        if (!media.control.empty()) out += "a=control:" + media.control + "\r\n";
+        return out;
+    }
+
+    /// Minimal SDP reader for ANNOUNCE bodies and DESCRIBE answers: m=, a=rtpmap/fmtp/ptime/extmap/control
+    static inline std::vector<SdpMedia> parse_sdp(const std::string &sdp) {
+        std::vector<SdpMedia> medias;
+        std::istringstream iss(sdp);
+        std::string line;
+
+        while (std::getline(iss, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.size() < 2 || line[1] != '=') continue;
+
+            if (line[0] == 'm') {
+                SdpMedia media;
+                std::istringstream ms(line.substr(2));
+                std::string proto;
+                int port = 0, pt = -1;
+                ms >> media.media >> port >> proto >> pt;
+                media.port = static_cast<uint16_t>(port);
+                media.payload_type = static_cast<uint8_t>(pt < 0 ? 0 : pt);
+                media.track = media.media == "audio" ? Audio : Video;
+
+                // static payload types carry no rtpmap
+                if (pt == 8) {
+                    media.encoding = "PCMA";
+                    media.codec = PCMA;
+                    media.clock_rate = 8000;
+                }
+                medias.push_back(std::move(media));
+                continue;
+            }
+
+            if (line[0] != 'a' || medias.empty()) continue;
+
+            SdpMedia &media = medias.back();
+            const std::string attr = line.substr(2);
+
+            if (attr.compare(0, 7, "rtpmap:") == 0) {
+                // rtpmap:<pt> <encoding>/<clock>[/<channels>]
+                const size_t sp = attr.find(' ');
+                if (sp == std::string::npos) continue;
+                std::string value = attr.substr(sp + 1);
+                std::string encoding = value.substr(0, value.find('/'));
+                std::transform(encoding.begin(), encoding.end(), encoding.begin(), ::toupper);
+                media.encoding = encoding;
+                media.codec = codec_from_encoding(encoding);
+
+                size_t slash = value.find('/');
+                if (slash != std::string::npos) {
+                    const char *rate = value.c_str() + slash + 1;
+                    media.clock_rate = static_cast<uint32_t>(std::strtoul(rate, nullptr, 10));
+                    slash = value.find('/', slash + 1);
+                    if (slash != std::string::npos) {
+                        const char *channels = value.c_str() + slash + 1;
+                        media.channels = static_cast<uint8_t>(std::strtoul(channels, nullptr, 10));
+                    }
+                }
+            } else if (attr.compare(0, 5, "fmtp:") == 0) {
+                const size_t sp = attr.find(' ');
+                if (sp == std::string::npos) continue;
+                std::istringstream fs(attr.substr(sp + 1));
+                std::string kv;
+                while (std::getline(fs, kv, ';')) {
+                    kv.erase(0, kv.find_first_not_of(' '));
+                    const size_t eq = kv.find('=');
+                    if (eq == std::string::npos) continue;
+                    std::string key = kv.substr(0, eq);
+                    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+                    media.fmtp[key] = kv.substr(eq + 1);
+                }
+            } else if (attr.compare(0, 6, "ptime:") == 0) {
+                media.ptime = static_cast<uint32_t>(std::strtoul(attr.c_str() + 6, nullptr, 10));
+            } else if (attr.compare(0, 8, "control:") == 0) {
+                media.control = attr.substr(8);
+            } else if (attr.compare(0, 7, "extmap:") == 0) {
+                // extmap:<id>[/<direction>] <uri> [<attributes>]
+                const auto id = std::strtoul(attr.c_str() + 7, nullptr, 10);
+                const size_t sp = attr.find(' ');
+                if (id == 0 || id > 255 || sp == std::string::npos) continue;
+                std::string uri = attr.substr(sp + 1);
+                media.extmap[static_cast<uint8_t>(id)] = uri.substr(0, uri.find(' '));
+            }
+        }
+        return medias;
+    }
+}
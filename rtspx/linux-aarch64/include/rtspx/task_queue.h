@@ -0,0 +1,163 @@
+#pragma once
+
+#include <new>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+
+namespace rtspx::net {
+    /*
+     * Move-only void() callable stored inline, so posting a small lambda does not allocate.
+     * Callables larger than STORAGE_SIZE (or not nothrow movable) are boxed on the heap.
+     */
+    class InlineTask {
+    public:
+        static constexpr size_t STORAGE_SIZE = 48;
+
+        InlineTask() = default;
+
+        template<typename F, typename Fn = std::decay_t<F>,
+                typename = std::enable_if_t<!std::is_same<Fn, InlineTask>::value> >
+        InlineTask(F &&f) { // NOLINT(google-explicit-constructor)
+            if constexpr (is_inline<Fn>()) {
+                ::new(static_cast<void *>(storage_)) Fn(std::forward<F>(f));
+                invoke_ = [](void *p) { (*static_cast<Fn *>(p))(); };
+                manage_ = [](void *dst, void *src) {
+                    if (dst != nullptr) ::new(dst) Fn(std::move(*static_cast<Fn *>(src)));
+                    static_cast<Fn *>(src)->~Fn();
+                };
+            } else {
+                ::new(static_cast<void *>(storage_)) Fn *(new Fn(std::forward<F>(f)));
+                invoke_ = [](void *p) { (**static_cast<Fn **>(p))(); };
+                manage_ = [](void *dst, void *src) {
+                    Fn *&boxed = *static_cast<Fn **>(src);
+                    if (dst != nullptr) {
+                        ::new(dst) Fn *(boxed);
+                    } else {
+                        delete boxed;
+                    }
+                };
+            }
+        }
+
+        InlineTask(InlineTask &&other) noexcept { take(other); }
+
+        InlineTask &operator=(InlineTask &&other) noexcept {
+            if (this != &other) {
+                reset();
+                take(other);
+            }
+            return *this;
+        }
+
+        ~InlineTask() { reset(); }
+
+        InlineTask(const InlineTask &) = delete;
+
+        InlineTask &operator=(const InlineTask &) = delete;
+
+        void operator()() { invoke_(storage_); }
+
+        explicit operator bool() const { return invoke_ != nullptr; }
+
+        void reset() {
+            if (manage_ == nullptr) return;
+            manage_(nullptr, storage_);
+            invoke_ = nullptr;
+            manage_ = nullptr;
+        }
+
+    private:
+        template<typename Fn>
+        static constexpr bool is_inline() {
+            return sizeof(Fn) <= STORAGE_SIZE && alignof(Fn) <= alignof(std::max_align_t) &&
+                   std::is_nothrow_move_constructible<Fn>::value;
+        }
+
+        void take(InlineTask &other) {
+            if (other.manage_ == nullptr) return;
+            other.manage_(storage_, other.storage_);
+            invoke_ = other.invoke_;
+            manage_ = other.manage_;
+            other.invoke_ = nullptr;
+            other.manage_ = nullptr;
+        }
+
+    private:
+        alignas(std::max_align_t) unsigned char storage_[STORAGE_SIZE];
+        void (*invoke_)(void *){nullptr};
+        void (*manage_)(void *dst, void *src){nullptr}; // move src into dst (if any) and destroy src
+    };
+
+    /*
+     * Bounded multi-producer single-consumer ring of InlineTask (Vyukov sequence slots).
+     * push() is lock-free and fails when full, pop() must only be called from the consumer thread.
+     */
+    class MpscTaskRing {
+    public:
+        explicit MpscTaskRing(size_t capacity = 4096) {
+            capacity_ = 1;
+            while (capacity_ < capacity) capacity_ <<= 1;
+            mask_ = capacity_ - 1;
+            slots_ = new Slot[capacity_];
+            for (size_t i = 0; i < capacity_; ++i) slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        ~MpscTaskRing() { delete[] slots_; }
+
+        MpscTaskRing(const MpscTaskRing &) = delete;
+
+        MpscTaskRing &operator=(const MpscTaskRing &) = delete;
+
+        bool push(InlineTask &&task) {
+            size_t pos = tail_.load(std::memory_order_relaxed);
+            Slot *slot;
+            while (true) {
+                slot = &slots_[pos & mask_];
+                const size_t seq = slot->seq.load(std::memory_order_acquire);
+                const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+                } else if (diff < 0) {
+                    return false; // full
+                } else {
+                    pos = tail_.load(std::memory_order_relaxed);
+                }
+            }
+            slot->task = std::move(task);
+            slot->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(InlineTask &task) {
+            Slot &slot = slots_[head_ & mask_];
+            if (slot.seq.load(std::memory_order_acquire) != head_ + 1) return false;
+            task = std::move(slot.task);
+            slot.seq.store(head_ + capacity_, std::memory_order_release);
+            ++head_;
+            return true;
+        }
+
+        /// Consumer side check, a push in flight may not be visible yet
+        [[nodiscard]] bool empty() const {
+            return slots_[head_ & mask_].seq.load(std::memory_order_acquire) != head_ + 1;
+        }
+
+        [[nodiscard]] size_t capacity() const { return capacity_; }
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<size_t> seq{0};
+            InlineTask task;
+        };
+
+        Slot *slots_{nullptr};
+        size_t capacity_{0};
+        size_t mask_{0};
+
+        alignas(64) std::atomic<size_t> tail_{0};
+        alignas(64) size_t head_{0};
+    };
+}
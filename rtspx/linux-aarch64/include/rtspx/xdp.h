@@ -0,0 +1,513 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include <sched.h>
+#include <net/if.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#if __has_include(<linux/if_xdp.h>)
+#include <linux/if_xdp.h>
+#define RTSPX_HAS_AF_XDP 1
+#else
+#define RTSPX_HAS_AF_XDP 0
+#endif
+
+#include "rtspx/poller.h"
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+namespace rtspx::net {
+    struct XdpConfig {
+        std::string ifname{};
+        uint32_t queue_id{0};
+        uint32_t num_frames{4096}; // UMEM frames, also the TX ring size (power of two)
+        uint32_t frame_size{2048};
+        bool zero_copy{false}; // false binds in copy mode, which also works on generic XDP (veth, any driver)
+        uint8_t next_hop_mac[6]{}; // all zero: look up the destination in the neighbour table
+    };
+
+    /*
+     * AF_XDP transmit of prebuilt Ethernet/IPv4/UDP frames, experimental.
+     *
+     * The frames go straight into the UMEM TX ring of one NIC queue and skip the kernel UDP/IP stack, a
+     * flush() publishes the batch and kicks the driver. Only transmit is set up, no XDP program is needed.
+     * The destination MAC comes from next_hop_mac or /proc/net/arp; send() returns false for unresolved
+     * destinations so the caller can use the kernel path (which also triggers ARP).
+     * In copy mode one sendto() transmits at most 32 frames (TX_BATCH_SIZE in the kernel), so flush() kicks
+     * until the kernel has taken everything that was published.
+     * Not thread-safe.
+     */
+    class XdpSender {
+    public:
+        XdpSender() = default;
+
+        ~XdpSender() { close(); }
+
+        XdpSender(const XdpSender &) = delete;
+
+        XdpSender &operator=(const XdpSender &) = delete;
+
+        /// false when AF_XDP is not available (kernel, permissions, interface)
+        bool open(const XdpConfig &config, uint16_t src_port) {
+#if RTSPX_HAS_AF_XDP
+            if (fd_ >= 0) return false;
+            config_ = config;
+            src_port_ = src_port;
+            if (config_.num_frames < 64 || (config_.num_frames & (config_.num_frames - 1)) != 0) return false;
+            if (!read_interface()) return false;
+
+            fd_ = ::socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+            if (fd_ < 0) return false;
+
+            umem_size_ = static_cast<size_t>(config_.num_frames) * config_.frame_size;
+            void *umem = ::mmap(nullptr, umem_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (umem == MAP_FAILED) return fail();
+            umem_ = static_cast<uint8_t *>(umem);
+
+            xdp_umem_reg reg{};
+            reg.addr = reinterpret_cast<uintptr_t>(umem_);
+            reg.len = umem_size_;
+            reg.chunk_size = config_.frame_size;
+            const uint32_t ring_size = config_.num_frames;
+            const uint32_t fill_size = 64; // the kernel wants a fill ring even for transmit only
+            if (::setsockopt(fd_, SOL_XDP, XDP_UMEM_REG, &reg, sizeof(reg)) != 0 ||
+                ::setsockopt(fd_, SOL_XDP, XDP_UMEM_FILL_RING, &fill_size, sizeof(fill_size)) != 0 ||
+                ::setsockopt(fd_, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ring_size, sizeof(ring_size)) != 0 ||
+                ::setsockopt(fd_, SOL_XDP, XDP_TX_RING, &ring_size, sizeof(ring_size)) != 0) {
+                return fail();
+            }
+
+            xdp_mmap_offsets off{};
+            socklen_t len = sizeof(off);
+            if (::getsockopt(fd_, SOL_XDP, XDP_MMAP_OFFSETS, &off, &len) != 0) return fail();
+            if (!map_ring(tx_, off.tx, sizeof(xdp_desc), ring_size, XDP_PGOFF_TX_RING) ||
+                !map_ring(cq_, off.cr, sizeof(uint64_t), ring_size, XDP_UMEM_PGOFF_COMPLETION_RING) ||
+                !map_ring(fq_, off.fr, sizeof(uint64_t), fill_size, XDP_UMEM_PGOFF_FILL_RING)) {
+                return fail();
+            }
+
+            sockaddr_xdp addr{};
+            addr.sxdp_family = AF_XDP;
+            addr.sxdp_ifindex = ifindex_;
+            addr.sxdp_queue_id = config_.queue_id;
+            addr.sxdp_flags = config_.zero_copy ? XDP_ZEROCOPY : XDP_COPY;
+            if (::bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) return fail();
+
+            free_.clear();
+            for (uint32_t i = config_.num_frames; i-- > 0;) {
+                free_.push_back(static_cast<uint64_t>(i) * config_.frame_size);
+            }
+            return true;
+#else
+            (void) config;
+            (void) src_port;
+            return false;
+#endif
+        }
+
+        void close() {
+#if RTSPX_HAS_AF_XDP
+            for (Ring *ring: {&tx_, &cq_, &fq_}) {
+                if (ring->map != nullptr) ::munmap(ring->map, ring->map_size);
+                *ring = Ring{};
+            }
+            if (umem_ != nullptr) ::munmap(umem_, umem_size_);
+            umem_ = nullptr;
+            published_ = 0;
+            num_completed_ = num_queued_; // frames left in the rings are gone
+#endif
+            if (fd_ >= 0) ::close(fd_);
+            fd_ = -1;
+        }
+
+        [[nodiscard]] bool is_open() const { return fd_ >= 0; }
+
+        /// Queue one UDP datagram, false when the ring is full or the destination MAC is unknown
+        bool send(const sockaddr_in &dst, const uint8_t *data, size_t size) {
+#if RTSPX_HAS_AF_XDP
+            if (fd_ < 0 || HEADERS_SIZE + size > config_.frame_size) return false;
+
+            const uint8_t *mac = resolve(dst.sin_addr.s_addr);
+            if (mac == nullptr) return false;
+
+            if (free_.empty()) reclaim();
+            if (free_.empty() || tx_.cached_prod - tx_cons() >= tx_.size) return false;
+
+            const uint64_t frame = free_.back();
+            free_.pop_back();
+            uint8_t *p = umem_ + frame;
+            write_headers(p, mac, dst, size);
+            std::memcpy(p + HEADERS_SIZE, data, size);
+
+            auto *desc = static_cast<xdp_desc *>(tx_.ring) + (tx_.cached_prod & (tx_.size - 1));
+            desc->addr = frame;
+            desc->len = static_cast<uint32_t>(HEADERS_SIZE + size);
+            desc->options = 0;
+            ++tx_.cached_prod;
+            ++num_queued_;
+            if (tx_.cached_prod - published_ >= BATCH) flush();
+            return true;
+#else
+            (void) dst;
+            (void) data;
+            (void) size;
+            return false;
+#endif
+        }
+
+        /// Publish queued frames and wake the driver
+        void flush() {
+#if RTSPX_HAS_AF_XDP
+            if (fd_ < 0 || tx_.cached_prod == published_) return;
+            __atomic_store_n(tx_.producer, tx_.cached_prod, __ATOMIC_RELEASE);
+            num_packets_ += tx_.cached_prod - published_;
+            published_ = tx_.cached_prod;
+            kick();
+            reclaim();
+#endif
+        }
+
+        /// Flush and wait up to timeout_ms until the first `queued` frames are sent, true when they are
+        bool drain(uint64_t queued, int timeout_ms) {
+#if RTSPX_HAS_AF_XDP
+            if (fd_ < 0) return true;
+            flush();
+            const int64_t deadline = now_ms() + timeout_ms;
+            while (num_completed_ < queued) {
+                if (now_ms() >= deadline) return false;
+                ::sched_yield();
+                kick();
+                reclaim();
+            }
+#else
+            (void) queued;
+            (void) timeout_ms;
+#endif
+            return true;
+        }
+
+        [[nodiscard]] uint64_t num_packets() const { return num_packets_; }
+
+        /// Frames queued by send() so far, drain() takes this as a position in the stream
+        [[nodiscard]] uint64_t num_queued() const { return num_queued_; }
+
+        [[nodiscard]] uint64_t num_completed() const { return num_completed_; }
+
+    private:
+        static constexpr size_t ETH_SIZE = 14;
+        static constexpr size_t IP_SIZE = 20;
+        static constexpr size_t UDP_SIZE = 8;
+        static constexpr size_t HEADERS_SIZE = ETH_SIZE + IP_SIZE + UDP_SIZE;
+        static constexpr uint32_t BATCH = 64;
+        static constexpr uint32_t KICK_BATCH = 32; // TX_BATCH_SIZE of the copy-mode transmit
+        static constexpr int64_t ARP_REFRESH_MS = 1000;
+
+        struct Ring {
+            uint32_t *producer{nullptr};
+            uint32_t *consumer{nullptr};
+            uint32_t *flags{nullptr};
+            void *ring{nullptr};
+            uint32_t size{0};
+            uint32_t cached_prod{0};
+            uint32_t cached_cons{0};
+            void *map{nullptr};
+            size_t map_size{0};
+        };
+
+        struct Mac {
+            uint8_t addr[6];
+        };
+
+        bool fail() {
+            close();
+            return false;
+        }
+
+#if RTSPX_HAS_AF_XDP
+        bool map_ring(Ring &ring, const xdp_ring_offset &off, size_t entry, uint32_t size, off_t pgoff) {
+            ring.map_size = off.desc + size * entry;
+            void *map = ::mmap(nullptr, ring.map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, pgoff);
+            if (map == MAP_FAILED) return false;
+            auto *base = static_cast<uint8_t *>(map);
+            ring.map = map;
+            ring.producer = reinterpret_cast<uint32_t *>(base + off.producer);
+            ring.consumer = reinterpret_cast<uint32_t *>(base + off.consumer);
+            ring.flags = reinterpret_cast<uint32_t *>(base + off.flags);
+            ring.ring = base + off.desc;
+            ring.size = size;
+            return true;
+        }
+
+        /// Copy mode transmits inside sendto() and stops with EAGAIN after TX_BATCH_SIZE frames, the ring
+        /// flag is only a hint for zero-copy drivers
+        void kick() {
+            if (config_.zero_copy) {
+                if (__atomic_load_n(tx_.flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP) {
+                    ::sendto(fd_, nullptr, 0, MSG_DONTWAIT, nullptr, 0);
+                }
+                return;
+            }
+            for (uint32_t i = 0; i <= tx_.size / KICK_BATCH && tx_cons() != published_; ++i) {
+                if (::sendto(fd_, nullptr, 0, MSG_DONTWAIT, nullptr, 0) < 0 && errno != EAGAIN && errno != EBUSY &&
+                    errno != ENOBUFS) {
+                    return;
+                }
+            }
+        }
+
+        uint32_t tx_cons() {
+            tx_.cached_cons = __atomic_load_n(tx_.consumer, __ATOMIC_ACQUIRE);
+            return tx_.cached_cons;
+        }
+
+        /// Sent frames come back through the completion ring
+        void reclaim() {
+            const uint32_t prod = __atomic_load_n(cq_.producer, __ATOMIC_ACQUIRE);
+            uint32_t cons = *cq_.consumer;
+            if (prod == cons) return;
+            const auto *addrs = static_cast<const uint64_t *>(cq_.ring);
+            num_completed_ += prod - cons;
+            for (; cons != prod; ++cons) free_.push_back(addrs[cons & (cq_.size - 1)]);
+            __atomic_store_n(cq_.consumer, cons, __ATOMIC_RELEASE);
+        }
+#endif
+
+        bool read_interface() {
+            ifindex_ = ::if_nametoindex(config_.ifname.c_str());
+            if (ifindex_ == 0) return false;
+
+            const int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+            if (fd < 0) return false;
+            ifreq req{};
+            std::snprintf(req.ifr_name, sizeof(req.ifr_name), "%s", config_.ifname.c_str());
+            bool ok = ::ioctl(fd, SIOCGIFHWADDR, &req) == 0;
+            if (ok) std::memcpy(src_mac_, req.ifr_hwaddr.sa_data, 6);
+            ok = ok && ::ioctl(fd, SIOCGIFADDR, &req) == 0;
+            if (ok) src_ip_ = reinterpret_cast<sockaddr_in *>(&req.ifr_addr)->sin_addr.s_addr;
+            ::close(fd);
+            return ok;
+        }
+
+        const uint8_t *resolve(uint32_t ip) {
+            static constexpr uint8_t zero[6] = {};
+            if (std::memcmp(config_.next_hop_mac, zero, 6) != 0) return config_.next_hop_mac;
+
+            auto it = neighbours_.find(ip);
+            if (it != neighbours_.end()) return it->second.addr;
+
+            const int64_t now = now_ms();
+            if (now - arp_read_ms_ < ARP_REFRESH_MS) return nullptr;
+            arp_read_ms_ = now;
+            read_arp();
+            it = neighbours_.find(ip);
+            return it == neighbours_.end() ? nullptr : it->second.addr;
+        }
+
+        /// "IP address  HW type  Flags  HW address  Mask  Device", complete entries of our interface
+        void read_arp() {
+            FILE *fp = std::fopen("/proc/net/arp", "r");
+            if (fp == nullptr) return;
+            char line[256];
+            if (std::fgets(line, sizeof(line), fp) == nullptr) {
+                std::fclose(fp);
+                return;
+            }
+            char ip[64], mac[64], dev[64];
+            unsigned type, flags;
+            while (std::fgets(line, sizeof(line), fp) != nullptr) {
+                if (std::sscanf(line, "%63s 0x%x 0x%x %63s %*s %63s", ip, &type, &flags, mac, dev) != 5) continue;
+                if (!(flags & 0x2) || config_.ifname != dev) continue; // ATF_COM
+                Mac entry{};
+                unsigned b[6];
+                if (std::sscanf(mac, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) continue;
+                for (int i = 0; i < 6; ++i) entry.addr[i] = static_cast<uint8_t>(b[i]);
+                neighbours_[::inet_addr(ip)] = entry;
+            }
+            std::fclose(fp);
+        }
+
+        void write_headers(uint8_t *p, const uint8_t *dst_mac, const sockaddr_in &dst, size_t size) {
+            std::memcpy(p, dst_mac, 6);
+            std::memcpy(p + 6, src_mac_, 6);
+            p[12] = 0x08; // IPv4
+            p[13] = 0x00;
+
+            uint8_t *ip = p + ETH_SIZE;
+            ip[0] = 0x45;
+            ip[1] = 0;
+            write_be16(ip + 2, static_cast<uint16_t>(IP_SIZE + UDP_SIZE + size));
+            write_be16(ip + 4, ip_id_++);
+            write_be16(ip + 6, 0x4000); // DF
+            ip[8] = 64;
+            ip[9] = IPPROTO_UDP;
+            ip[10] = ip[11] = 0;
+            std::memcpy(ip + 12, &src_ip_, 4);
+            std::memcpy(ip + 16, &dst.sin_addr.s_addr, 4);
+            uint32_t sum = 0;
+            for (size_t i = 0; i < IP_SIZE; i += 2) sum += static_cast<uint32_t>(ip[i] << 8 | ip[i + 1]);
+            while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+            write_be16(ip + 10, static_cast<uint16_t>(~sum));
+
+            uint8_t *udp = ip + IP_SIZE;
+            write_be16(udp, src_port_);
+            std::memcpy(udp + 2, &dst.sin_port, 2);
+            write_be16(udp + 4, static_cast<uint16_t>(UDP_SIZE + size));
+            udp[6] = udp[7] = 0; // no UDP checksum, allowed over IPv4
+        }
+
+        static void write_be16(uint8_t *p, uint16_t v) {
+            p[0] = static_cast<uint8_t>(v >> 8);
+            p[1] = static_cast<uint8_t>(v);
+        }
+
+    private:
+        XdpConfig config_{};
+        int fd_{-1};
+        unsigned ifindex_{0};
+        uint8_t src_mac_[6]{};
+        uint32_t src_ip_{0};
+        uint16_t src_port_{0};
+        uint16_t ip_id_{0};
+
+        uint8_t *umem_{nullptr};
+        size_t umem_size_{0};
+        Ring tx_{};
+        Ring cq_{};
+        Ring fq_{};
+        uint32_t published_{0};
+        std::vector<uint64_t> free_;
+        uint64_t num_packets_{0};
+        uint64_t num_queued_{0};
+        uint64_t num_completed_{0};
+
+        std::unordered_map<uint32_t, Mac> neighbours_;
+        int64_t arp_read_ms_{-ARP_REFRESH_MS};
+    };
+
+    /*
+     * UDP sender for RTP/RTCP to viewers: AF_XDP when enable_xdp() succeeded and the destination is
+     * resolved, the kernel socket otherwise. The socket owns the source port, so RTCP from viewers still
+     * arrives on it. Call flush() after each burst (e.g. all packets of a frame).
+     * A destination that falls back to the kernel path (ring full) first waits for its frames still in the
+     * XDP ring, otherwise the kernel datagram overtakes them and the viewer sees RTP out of order.
+     */
+    class RtpUdpSender {
+    public:
+        RtpUdpSender() = default;
+
+        ~RtpUdpSender() { close(); }
+
+        RtpUdpSender(const RtpUdpSender &) = delete;
+
+        RtpUdpSender &operator=(const RtpUdpSender &) = delete;
+
+        bool open(const std::string &ip, uint16_t port) {
+            if (fd_ >= 0) return false;
+            fd_ = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd_ < 0) return false;
+
+            const int size = 1024 * 1024;
+            ::setsockopt(fd_, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = ip.empty() ? INADDR_ANY : ::inet_addr(ip.c_str());
+            socklen_t len = sizeof(addr);
+            if (::bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+                ::getsockname(fd_, reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+                close();
+                return false;
+            }
+            port_ = ntohs(addr.sin_port);
+            return true;
+        }
+
+        /// Experimental, false keeps the kernel path
+        bool enable_xdp(const XdpConfig &config) { return fd_ >= 0 && xdp_.open(config, port_); }
+
+        void close() {
+            xdp_.close();
+            pending_.clear();
+            if (fd_ >= 0) ::close(fd_);
+            fd_ = -1;
+        }
+
+        bool send(const sockaddr_in &dst, const uint8_t *data, size_t size) {
+            if (xdp_.is_open()) {
+                const uint64_t key = destination_key(dst);
+                if (xdp_.send(dst, data, size)) {
+                    pending_[key] = xdp_.num_queued();
+                    return true;
+                }
+                const auto it = pending_.find(key);
+                if (it != pending_.end()) {
+                    // on timeout the datagram still goes out, late beats lost
+                    xdp_.drain(it->second, DRAIN_TIMEOUT_MS);
+                    pending_.erase(it);
+                }
+            }
+            ++num_kernel_packets_;
+            return ::sendto(fd_, data, size, MSG_NOSIGNAL, reinterpret_cast<const sockaddr *>(&dst), sizeof(dst)) >= 0;
+        }
+
+        void flush() {
+            xdp_.flush();
+            if (pending_.size() > MAX_PENDING) prune();
+        }
+
+        [[nodiscard]] int fd() const { return fd_; }
+
+        [[nodiscard]] uint16_t port() const { return port_; }
+
+        [[nodiscard]] bool is_xdp() const { return xdp_.is_open(); }
+
+        [[nodiscard]] uint64_t num_xdp_packets() const { return xdp_.num_packets(); }
+
+        [[nodiscard]] uint64_t num_kernel_packets() const { return num_kernel_packets_; }
+
+    private:
+        static constexpr int DRAIN_TIMEOUT_MS = 5;
+        static constexpr size_t MAX_PENDING = 1024;
+
+        static uint64_t destination_key(const sockaddr_in &dst) {
+            return static_cast<uint64_t>(dst.sin_addr.s_addr) << 16 | dst.sin_port;
+        }
+
+        /// Forget destinations whose XDP frames are all sent
+        void prune() {
+            for (auto it = pending_.begin(); it != pending_.end();) {
+                if (it->second <= xdp_.num_completed()) {
+                    it = pending_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+    private:
+        int fd_{-1};
+        uint16_t port_{0};
+        XdpSender xdp_;
+        std::unordered_map<uint64_t, uint64_t> pending_; // destination -> num_queued() after its last XDP frame
+        uint64_t num_kernel_packets_{0};
+    };
+}
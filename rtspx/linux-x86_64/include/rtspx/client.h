@@ -0,0 +1,288 @@
+#pragma once
+
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "rtspx/sdp.h"
+#include "rtspx/coro.h"
+#include "rtspx/poller.h"
+#include "rtspx/depacketizer.h"
+
+#if RTSPX_HAS_COROUTINES
+
+namespace rtspx {
+    struct RtspClientConfig {
+        bool tcp{true}; // RTP over the RTSP connection, false for UDP (falls back to TCP on 461)
+        uint32_t timeout_ms{10000}; // connect/handshake timeout and max gap between media packets
+        std::string user_agent{"rtspx"};
+    };
+
+    /*
+     * Lightweight RTSP pull client (OPTIONS/DESCRIBE/SETUP/PLAY) for restreaming cameras without FFmpeg.
+     *
+     * RTP is depacketized into Annex-B access units (H.264/H.265), ADTS AAC or G.711A frames and delivered
+     * as EncodedShared on the poller thread, ready for MediaSession::push_data. Each session is one coroutine
+     * on the given net::Poller (CoRtspConnection + rtsp_play from coro.h), one poller thread is meant to carry
+     * hundreds of clients.
+     *
+     * Usage: create() -> set callbacks -> open(); close() when done. The poller must outlive its clients.
+     * Callbacks run on the poller thread and must not block.
+     */
+    class RtspClient : public std::enable_shared_from_this<RtspClient> {
+    public:
+        enum State {
+            Idle,
+            Connecting,
+            Handshaking,
+            Playing,
+            Closed
+        };
+
+        using FrameCallback = std::function<void(MediaTrack track, const EncodedShared &frame)>;
+        using PlayCallback = std::function<void(const std::vector<SdpMedia> &medias)>;
+        using CloseCallback = std::function<void(const std::string &reason)>;
+
+        RtspClient(net::Poller &poller, std::string url, RtspClientConfig config = {})
+                : poller_(poller), url_(std::move(url)), config_(std::move(config)),
+                  conn_(poller, CoRtspConfig{config_.timeout_ms, config_.user_agent}) {
+            std::fill(std::begin(channel_track_), std::end(channel_track_), -1);
+        }
+
+        ~RtspClient() { release(); }
+
+        RtspClient(const RtspClient &) = delete;
+
+        RtspClient &operator=(const RtspClient &) = delete;
+
+        void set_frame_callback(FrameCallback cb) { frame_cb_ = std::move(cb); }
+
+        void set_play_callback(PlayCallback cb) { play_cb_ = std::move(cb); }
+
+        void set_close_callback(CloseCallback cb) { close_cb_ = std::move(cb); }
+
+        /// Resolve the url host (blocking, on the caller thread) and start the session on the poller
+        bool open() {
+            if (state_ != Idle) return false;
+            RtspUrl parsed;
+            if (!resolve_rtsp_url(url_, parsed, addr_)) return false;
+            start();
+            return true;
+        }
+
+        /*
+         * Reconnect a closed client in place, e.g. from the close callback. The resolved address is reused
+         * (no DNS on the poller thread) and buffers keep their capacity, so reconnect storms do not allocate
+         * a fresh client per camera.
+         */
+        bool reopen() {
+            if (state_ != Closed) return false;
+            start();
+            return true;
+        }
+
+        /// Send TEARDOWN and release sockets, the close callback reports "closed"
+        void close() {
+            auto self = shared_from_this();
+            poller_.post([self]() {
+                if (self->state_ == Closed) return;
+                if (!self->running_) return self->finish("closed");
+                // the session coroutine wakes up on the closed socket and finishes with "closed"
+                self->closing_ = true;
+                self->conn_.close();
+            });
+        }
+
+        [[nodiscard]] State state() const { return state_; }
+
+        [[nodiscard]] const std::string &url() const { return url_; }
+
+        /// Medias being played, valid from the play callback on
+        [[nodiscard]] std::vector<SdpMedia> medias() const {
+            std::vector<SdpMedia> medias;
+            for (const auto &track: tracks_) medias.push_back(track.media);
+            return medias;
+        }
+
+        static std::shared_ptr<RtspClient> create(net::Poller &poller, std::string url, RtspClientConfig config = {}) {
+            return std::make_shared<RtspClient>(poller, std::move(url), std::move(config));
+        }
+
+    private:
+        struct Track {
+            SdpMedia media;
+            std::unique_ptr<Depacketizer> depacketizer;
+            int rtp_fd{-1};
+            int rtcp_fd{-1};
+        };
+
+        void start() {
+            release();
+            tracks_.clear();
+            std::fill(std::begin(channel_track_), std::end(channel_track_), -1);
+            closing_ = false;
+            running_ = true;
+            state_ = Connecting;
+            // the coroutine holds a reference, the client lives until its session is over
+            net::co_spawn(poller_, run(shared_from_this()));
+        }
+
+        static net::CoTask<void> run(std::shared_ptr<RtspClient> self) {
+            const std::string reason = co_await self->session();
+            self->finish(reason);
+        }
+
+        /// Connect, handshake and receive media until an error, a timeout or close(); returns the close reason
+        net::CoTask<std::string> session() {
+            // one co_await per statement, GCC 12 miscompiles co_await in the operands of && and ||
+            bool ok = !closing_;
+            if (ok) ok = co_await conn_.connect(url_, addr_);
+            if (!ok) co_return closing_ ? "closed" : conn_.error();
+
+            state_ = Handshaking;
+            std::vector<SdpMedia> medias;
+            std::vector<int> channels;
+            CoUdpOpener udp;
+            if (!config_.tcp) udp = [this](size_t index, uint16_t ports[2]) { return open_udp(index, ports); };
+            conn_.set_interleaved_callback([this](uint8_t channel, const uint8_t *data, size_t size) {
+                on_rtp(channel_track_[channel], data, size);
+            });
+            ok = co_await rtsp_play(conn_, medias, channels, std::move(udp));
+            if (closing_) co_return "closed";
+            if (!ok) co_return conn_.error().empty() ? "no supported media" : conn_.error();
+
+            tracks_.resize(medias.size());
+            for (size_t i = 0; i < medias.size(); ++i) {
+                Track &track = tracks_[i];
+                track.media = std::move(medias[i]);
+                track.depacketizer = Depacketizer::create(track.media.depacketizer_config());
+                const MediaTrack id = track.media.track;
+                track.depacketizer->set_frame_callback([this, id](const EncodedShared &frame) {
+                    if (frame_cb_) frame_cb_(id, frame);
+                });
+                if (channels[i] >= 0) {
+                    channel_track_[channels[i]] = static_cast<int>(i);
+                    close_udp(track); // opened before the server refused UDP
+                }
+            }
+
+            state_ = Playing;
+            int64_t keepalive_ms = active_ms_ = net::now_ms();
+            if (play_cb_) play_cb_(this->medias());
+
+            const uint32_t slice_ms = std::max<uint32_t>(config_.timeout_ms / 4, 100);
+            const int64_t keepalive = static_cast<int64_t>(std::max<uint32_t>(conn_.session_timeout_s(), 2)) * 500;
+            while (true) {
+                ok = co_await conn_.pump(slice_ms);
+                if (closing_) co_return "closed";
+                if (!ok) co_return "connection closed";
+
+                const int64_t now = net::now_ms();
+                if (now - active_ms_ > config_.timeout_ms) co_return "media timeout";
+                if (now - keepalive_ms >= keepalive) {
+                    keepalive_ms = now;
+                    // frames keep flowing to the callback while the answer is awaited
+                    const char *method = conn_.supports("GET_PARAMETER") ? "GET_PARAMETER" : "OPTIONS";
+                    const RtspMsg answer = co_await conn_.request(method, conn_.url());
+                    if (closing_) co_return "closed";
+                    if (answer.status == 0) co_return conn_.error();
+                }
+            }
+        }
+
+        /// TEARDOWN when playing, release the sockets and report the reason
+        void finish(const std::string &reason) {
+            conn_.set_interleaved_callback(nullptr);
+            conn_.close();
+            release();
+            running_ = false;
+            closing_ = false;
+            state_ = Closed;
+            if (close_cb_) close_cb_(reason);
+        }
+
+        bool open_udp(size_t index, uint16_t ports[2]) {
+            if (tracks_.size() <= index) tracks_.resize(index + 1);
+            Track &track = tracks_[index];
+            int fds[2];
+            if (!net::open_udp_pair({}, fds, ports)) return false;
+            track.rtp_fd = fds[0];
+            track.rtcp_fd = fds[1];
+
+            std::weak_ptr<RtspClient> weak = shared_from_this();
+            const int rtp_fd = fds[0], rtcp_fd = fds[1];
+            poller_.add(rtp_fd, EPOLLIN | EPOLLET, [weak, index, rtp_fd](uint32_t) {
+                auto self = weak.lock();
+                if (!self) return;
+                uint8_t buf[RTP_MAX_PACKET_SIZE * 2];
+                ssize_t n;
+                while (self->running_ && (n = ::recv(rtp_fd, buf, sizeof(buf), 0)) > 0) {
+                    self->on_rtp(static_cast<int>(index), buf, static_cast<size_t>(n));
+                }
+            });
+            poller_.add(rtcp_fd, EPOLLIN, [rtcp_fd](uint32_t) {
+                char drain[1500];
+                while (::recv(rtcp_fd, drain, sizeof(drain), 0) > 0) {}
+            });
+            return true;
+        }
+
+        void on_rtp(int index, const uint8_t *data, size_t size) {
+            if (index < 0 || index >= static_cast<int>(tracks_.size()) || state_ != Playing) return;
+            if (is_rtcp_packet(data, size)) return;
+            active_ms_ = net::now_ms();
+            tracks_[index].depacketizer->input(data, size);
+        }
+
+        void close_udp(Track &track) {
+            std::vector<int> fds;
+            if (track.rtp_fd >= 0) fds.push_back(track.rtp_fd);
+            if (track.rtcp_fd >= 0) fds.push_back(track.rtcp_fd);
+            track.rtp_fd = track.rtcp_fd = -1;
+            if (fds.empty()) return;
+
+            auto cleanup = [&poller = poller_, fds]() {
+                for (const int fd: fds) {
+                    poller.remove(fd);
+                    ::close(fd);
+                }
+            };
+            // dropped without close() from another thread, the poller tables belong to the loop thread
+            if (poller_.is_running() && !poller_.in_loop_thread()) {
+                poller_.post(cleanup);
+            } else {
+                cleanup();
+            }
+        }
+
+        void release() {
+            for (auto &track: tracks_) close_udp(track);
+        }
+
+    private:
+        net::Poller &poller_;
+        std::string url_;
+        RtspClientConfig config_;
+        sockaddr_in addr_{};
+        State state_{Idle};
+        bool running_{false};
+        bool closing_{false};
+
+        CoRtspConnection conn_;
+        std::vector<Track> tracks_;
+        int channel_track_[256]{};
+        int64_t active_ms_{0};
+
+        FrameCallback frame_cb_;
+        PlayCallback play_cb_;
+        CloseCallback close_cb_;
+    };
+}
+
+#endif
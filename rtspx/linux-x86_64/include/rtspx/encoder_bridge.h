@@ -0,0 +1,174 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include "rtspx/sessionx.h"
+
+#if __has_include("vcodecx/codec.h")
+#include "vcodecx/codec.h"
+#define RTSPX_HAS_VCODECX 1
+#else
+#define RTSPX_HAS_VCODECX 0
+#endif
+
+#if RTSPX_HAS_VCODECX
+
+namespace rtspx {
+    struct EncoderBridgeConfig {
+        MediaTrack track{Video};
+        uint32_t pts_rate{1000}; // EncodedX::pts ticks per second, 0 stamps frames with their arrival time
+        uint32_t clock_rate{90000}; // RTP clock of the track
+    };
+
+    /*
+     * Restreams a vcodecx::Encoder into MediaSessions without copying the bitstream.
+     *
+     * Each EncodedX becomes an EncodedShared that points at the encoder's packet buffer, its holder aliases
+     * the EncodedX (which keeps the MPP/AVPacket buffer alive), so one packet is shared by every session.
+     * is_keyframe maps to VIDEO_FRAME_I, pts is rescaled from pts_rate to the RTP clock and counted from the
+     * first frame; a pts going backwards (encoder restart) continues one frame interval after the last one.
+     *
+     * Frames are pushed on the encoder's callback thread, so the encoder should run in WorkerMode::Callback.
+     */
+    class EncoderBridge : public std::enable_shared_from_this<EncoderBridge> {
+    public:
+        explicit EncoderBridge(std::shared_ptr<vcodecx::Encoder> encoder, EncoderBridgeConfig config = {})
+                : encoder_(std::move(encoder)), config_(config),
+                  sessions_(std::make_shared<const std::vector<std::shared_ptr<MediaSession> > >()) {}
+
+        ~EncoderBridge() { stop(); }
+
+        EncoderBridge(const EncoderBridge &) = delete;
+
+        EncoderBridge &operator=(const EncoderBridge &) = delete;
+
+        /// Subscribe to the encoder, the subscription keeps only a weak reference to the bridge
+        bool start() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (subscribe_id_ >= 0) return true;
+            if (!encoder_) return false;
+
+            std::weak_ptr<EncoderBridge> weak = shared_from_this();
+            subscribe_id_ = encoder_->subscribe([weak](const std::shared_ptr<vcodecx::EncodedX> &encoded) {
+                if (auto self = weak.lock()) self->on_encoded(encoded);
+            });
+            return subscribe_id_ >= 0;
+        }
+
+        void stop() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (subscribe_id_ < 0) return;
+            encoder_->unsubscribe(subscribe_id_);
+            subscribe_id_ = -1;
+        }
+
+        /// Add a session, its source is created from the encoder codec when the track has none yet
+        bool add_session(const std::shared_ptr<MediaSession> &session) {
+            if (!session) return false;
+            if (!session->has_channel(config_.track) && !session->add_source(config_.track, codec())) return false;
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto sessions = std::make_shared<std::vector<std::shared_ptr<MediaSession> > >(*sessions_);
+            if (std::find(sessions->begin(), sessions->end(), session) != sessions->end()) return true;
+            sessions->push_back(session);
+            sessions_ = std::move(sessions);
+            return true;
+        }
+
+        void remove_session(const std::shared_ptr<MediaSession> &session) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto sessions = std::make_shared<std::vector<std::shared_ptr<MediaSession> > >(*sessions_);
+            sessions->erase(std::remove(sessions->begin(), sessions->end(), session), sessions->end());
+            sessions_ = std::move(sessions);
+        }
+
+        [[nodiscard]] size_t num_sessions() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return sessions_->size();
+        }
+
+        [[nodiscard]] uint64_t num_frames() const { return num_frames_.load(std::memory_order_relaxed); }
+
+        /// rtspx codec of the encoder output
+        [[nodiscard]] CodecType codec() const {
+            if (!encoder_) return NONE;
+            return encoder_->encode_config().codec_type == vcodecx::CodecType::H264 ? H264 : H265;
+        }
+
+        static std::shared_ptr<EncoderBridge> create(std::shared_ptr<vcodecx::Encoder> encoder,
+                                                     EncoderBridgeConfig config = {}) {
+            auto bridge = std::make_shared<EncoderBridge>(std::move(encoder), config);
+            return bridge->start() ? bridge : nullptr;
+        }
+
+    private:
+        void on_encoded(const std::shared_ptr<vcodecx::EncodedX> &encoded) {
+            if (!encoded || encoded->data == nullptr || encoded->size == 0) return;
+            if (encoded->is_audio != (config_.track == Audio)) return;
+
+            std::shared_ptr<const std::vector<std::shared_ptr<MediaSession> > > sessions;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                sessions = sessions_;
+            }
+
+            const int64_t pts = rescale(encoded->pts);
+            const FrameType type = config_.track == Audio ? AUDIO_FRAME
+                                                           : encoded->is_keyframe ? VIDEO_FRAME_I : VIDEO_FRAME_P;
+            // aliasing holder: shares ownership of the EncodedX, which owns the packet buffer
+            const EncodedShared frame(encoded->data, encoded->size, pts, static_cast<uint32_t>(pts),
+                                      std::shared_ptr<void>(encoded, encoded->data), type);
+            for (const auto &session: *sessions) session->push_data(config_.track, frame);
+            num_frames_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        /// Source pts to RTP clock ticks since the first frame, only called from the encoder thread
+        int64_t rescale(int64_t pts) {
+            if (config_.pts_rate == 0) {
+                using namespace std::chrono;
+                pts = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+            }
+            const int64_t rate = config_.pts_rate == 0 ? 1000000 : config_.pts_rate;
+
+            if (!has_pts_) {
+                has_pts_ = true;
+                base_pts_ = pts;
+            }
+            int64_t ticks = ticks_offset_ + (pts - base_pts_) * static_cast<int64_t>(config_.clock_rate) / rate;
+            if (has_last_ && ticks <= last_ticks_) {
+                // restart or stalled clock: continue one frame after the last output
+                const int64_t next = last_ticks_ + std::max<int64_t>(last_delta_, 1);
+                ticks_offset_ += next - ticks;
+                ticks = next;
+            } else if (has_last_) {
+                last_delta_ = ticks - last_ticks_;
+            }
+            has_last_ = true;
+            last_ticks_ = ticks;
+            return ticks;
+        }
+
+    private:
+        std::shared_ptr<vcodecx::Encoder> encoder_;
+        EncoderBridgeConfig config_;
+
+        mutable std::mutex mutex_;
+        int subscribe_id_{-1};
+        std::shared_ptr<const std::vector<std::shared_ptr<MediaSession> > > sessions_;
+        std::atomic<uint64_t> num_frames_{0};
+
+        bool has_pts_{false};
+        bool has_last_{false};
+        int64_t base_pts_{0};
+        int64_t ticks_offset_{0};
+        int64_t last_ticks_{0};
+        int64_t last_delta_{0};
+    };
+}
+
+#endif
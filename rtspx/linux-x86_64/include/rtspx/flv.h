@@ -0,0 +1,346 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <utility>
+
+#include "rtspx/rtp.h"
+#include "rtspx/types.h"
+#include "rtspx/packetizer.h"
+#include "rtspx/depacketizer.h"
+
+namespace rtspx {
+    struct FlvConfig {
+        CodecType video{H264}; // H264, H265 (codec id 12) or NONE
+        CodecType audio{NONE}; // AAC, PCMA or NONE
+        uint32_t video_clock_rate{1000}; // pts units per second, 1000 = ms, 90000 for Depacketizer frames
+        uint32_t audio_clock_rate{1000}; // the sample rate for Depacketizer frames
+
+        // raw AAC (no ADTS header) is described with these
+        uint32_t sample_rate{44100};
+        uint8_t channels{2};
+        uint8_t aac_object_type{2};
+    };
+
+    /// One complete FLV tag (header + body + PreviousTagSize), shared by every viewer that sends it
+    using FlvTag = std::shared_ptr<const std::string>;
+
+    struct FlvPacket {
+        MediaTrack track{Video};
+        FlvTag tag; // the frame, null when nothing could be muxed yet (no parameter sets)
+        FlvTag config; // new AVC/HEVC/AAC sequence header, sent before the tag when set
+        bool keyframe{false};
+    };
+
+    /*
+     * EncodedShared frame -> FLV tags, the container side of HTTP-FLV.
+     *
+     * Annex-B NAL units are rewritten with 4-byte length prefixes, parameter sets and AUDs are taken out of
+     * the frame and published as a sequence header whenever they change. ADTS headers are stripped from
+     * AAC, the AudioSpecificConfig comes from the first ADTS header (or from the config for raw AAC).
+     *
+     * Timestamps are milliseconds from the first frame. Tracks with the same clock rate share one base, so
+     * their relative offset is kept, otherwise each track is anchored to the wall clock when it starts.
+     * Not thread-safe.
+     */
+    class FlvMuxer {
+    public:
+        explicit FlvMuxer(const FlvConfig &config) : config_(config) {
+            if (config_.video_clock_rate == 0) config_.video_clock_rate = 1000;
+            if (config_.audio_clock_rate == 0) config_.audio_clock_rate = 1000;
+        }
+
+        FlvMuxer(const FlvMuxer &) = delete;
+
+        FlvMuxer &operator=(const FlvMuxer &) = delete;
+
+        /// "FLV" file header + PreviousTagSize0
+        [[nodiscard]] std::string header() const {
+            uint8_t flags = 0;
+            if (config_.audio != NONE) flags |= 0x04;
+            if (config_.video != NONE) flags |= 0x01;
+            const char head[13] = {'F', 'L', 'V', 1, static_cast<char>(flags), 0, 0, 0, 9, 0, 0, 0, 0};
+            return {head, sizeof(head)};
+        }
+
+        bool mux(MediaTrack track, const EncodedShared &frame, FlvPacket &out) {
+            out = FlvPacket{};
+            out.track = track;
+            if (frame.data == nullptr || frame.size == 0) return false;
+
+            if (track == Video) {
+                if (config_.video == H264) return mux_avc(frame, out, false);
+                if (config_.video == H265) return mux_avc(frame, out, true);
+                return false;
+            }
+            if (config_.audio == AAC) return mux_aac(frame, out);
+            if (config_.audio == PCMA) return mux_g711a(frame, out);
+            return false;
+        }
+
+        /// Current sequence headers, for viewers that join mid-stream
+        [[nodiscard]] const FlvTag &video_config() const { return video_config_; }
+
+        [[nodiscard]] const FlvTag &audio_config() const { return audio_config_; }
+
+        [[nodiscard]] const FlvConfig &config() const { return config_; }
+
+    private:
+        static constexpr uint8_t TAG_AUDIO = 8;
+        static constexpr uint8_t TAG_VIDEO = 9;
+        static constexpr size_t TAG_HEADER_SIZE = 11;
+
+        /// Tag with the header in place and room for the body, finish() appends PreviousTagSize
+        static std::shared_ptr<std::string> begin_tag(uint8_t type, uint32_t timestamp, size_t body_size) {
+            auto tag = std::make_shared<std::string>();
+            tag->reserve(TAG_HEADER_SIZE + body_size + 4);
+            const uint8_t head[TAG_HEADER_SIZE] = {
+                    type,
+                    static_cast<uint8_t>(body_size >> 16), static_cast<uint8_t>(body_size >> 8),
+                    static_cast<uint8_t>(body_size),
+                    static_cast<uint8_t>(timestamp >> 16), static_cast<uint8_t>(timestamp >> 8),
+                    static_cast<uint8_t>(timestamp), static_cast<uint8_t>(timestamp >> 24), // extended
+                    0, 0, 0
+            };
+            tag->append(reinterpret_cast<const char *>(head), sizeof(head));
+            return tag;
+        }
+
+        static FlvTag finish(std::shared_ptr<std::string> tag) {
+            uint8_t size[4];
+            write_be32(size, static_cast<uint32_t>(tag->size()));
+            tag->append(reinterpret_cast<const char *>(size), sizeof(size));
+            return tag;
+        }
+
+        static void append(std::string &tag, const uint8_t *data, size_t size) {
+            tag.append(reinterpret_cast<const char *>(data), size);
+        }
+
+        static void append_be16(std::string &tag, size_t v) {
+            tag.push_back(static_cast<char>(v >> 8));
+            tag.push_back(static_cast<char>(v));
+        }
+
+        static void append_be32(std::string &tag, size_t v) {
+            uint8_t b[4];
+            write_be32(b, static_cast<uint32_t>(v));
+            append(tag, b, sizeof(b));
+        }
+
+        uint32_t timestamp(MediaTrack track, int64_t pts) {
+            const bool shared = config_.video_clock_rate == config_.audio_clock_rate;
+            const int index = shared ? 0 : track;
+            const uint32_t rate = track == Video ? config_.video_clock_rate : config_.audio_clock_rate;
+
+            if (!started_) {
+                started_ = true;
+                start_ms_ = now_ms();
+            }
+            Anchor &anchor = anchors_[index];
+            if (!anchor.set) {
+                anchor.set = true;
+                anchor.pts = pts;
+                anchor.offset_ms = shared ? 0 : now_ms() - start_ms_;
+            }
+            const int64_t ms = anchor.offset_ms + (pts - anchor.pts) * 1000 / static_cast<int64_t>(rate);
+            return ms > 0 ? static_cast<uint32_t>(ms) : 0;
+        }
+
+        bool mux_avc(const EncodedShared &frame, FlvPacket &out, bool hevc) {
+            bool keyframe = frame.frame_type == VIDEO_FRAME_I;
+            bool params_changed = false;
+            size_t body_size = 5;
+            nals_.clear();
+
+            for_each_annexb_nal(frame.data, frame.size, [&](const uint8_t *nal, size_t size) {
+                const uint8_t type = hevc ? (nal[0] >> 1) & 0x3F : nal[0] & 0x1F;
+                std::string *param = nullptr;
+                if (hevc) {
+                    if (type == 32) param = &vps_;
+                    if (type == 33) param = &sps_;
+                    if (type == 34) param = &pps_;
+                    if (type == 35) return; // AUD
+                    if (type >= 16 && type <= 21) keyframe = true; // IRAP
+                } else {
+                    if (type == 7) param = &sps_;
+                    if (type == 8) param = &pps_;
+                    if (type == 9) return; // AUD
+                    if (type == 5) keyframe = true;
+                }
+                if (param != nullptr) {
+                    if (param->size() != size || param->compare(0, size, reinterpret_cast<const char *>(nal), size)) {
+                        param->assign(reinterpret_cast<const char *>(nal), size);
+                        params_changed = true;
+                    }
+                    return;
+                }
+                nals_.emplace_back(nal, size);
+                body_size += 4 + size;
+            });
+
+            const uint8_t codec_id = hevc ? 12 : 7;
+            if (params_changed && !sps_.empty() && !pps_.empty() && (!hevc || !vps_.empty())) {
+                auto tag = begin_tag(TAG_VIDEO, 0, 0);
+                tag->push_back(static_cast<char>(0x10 | codec_id));
+                tag->append(4, '\0'); // sequence header, composition time 0
+                if (hevc) {
+                    hevc_config_record(*tag);
+                } else {
+                    avc_config_record(*tag);
+                }
+                set_body_size(*tag);
+                video_config_ = finish(std::move(tag));
+                out.config = video_config_;
+            }
+            if (!video_config_ || nals_.empty()) return out.config != nullptr;
+
+            auto tag = begin_tag(TAG_VIDEO, timestamp(Video, frame.pts), body_size);
+            tag->push_back(static_cast<char>((keyframe ? 0x10 : 0x20) | codec_id));
+            tag->push_back(1); // NALU
+            tag->append(3, '\0'); // composition time, frames come in decode order without B-frame offsets
+            for (const auto &nal: nals_) {
+                append_be32(*tag, nal.second);
+                append(*tag, nal.first, nal.second);
+            }
+            out.tag = finish(std::move(tag));
+            out.keyframe = keyframe;
+            return true;
+        }
+
+        /// AVCDecoderConfigurationRecord, lengthSizeMinusOne 3
+        void avc_config_record(std::string &tag) const {
+            const auto *sps = reinterpret_cast<const uint8_t *>(sps_.data());
+            const uint8_t head[6] = {
+                    1, sps_.size() > 1 ? sps[1] : uint8_t(66), sps_.size() > 2 ? sps[2] : uint8_t(0),
+                    sps_.size() > 3 ? sps[3] : uint8_t(30), 0xFF, 0xE1
+            };
+            append(tag, head, sizeof(head));
+            append_be16(tag, sps_.size());
+            tag += sps_;
+            tag.push_back(1);
+            append_be16(tag, pps_.size());
+            tag += pps_;
+        }
+
+        /// HEVCDecoderConfigurationRecord, general profile/tier/level copied from the SPS, 4:2:0 8-bit assumed
+        void hevc_config_record(std::string &tag) const {
+            // unescape the SPS head: NAL header (2), vps id/max sub layers/nesting (1), general PTL (12)
+            uint8_t rbsp[15] = {};
+            size_t n = 0, zeros = 0;
+            for (size_t i = 0; i < sps_.size() && n < sizeof(rbsp); ++i) {
+                const auto b = static_cast<uint8_t>(sps_[i]);
+                if (zeros >= 2 && b == 3) {
+                    zeros = 0;
+                    continue;
+                }
+                zeros = b == 0 ? zeros + 1 : 0;
+                rbsp[n++] = b;
+            }
+
+            tag.push_back(1);
+            append(tag, rbsp + 3, 12); // profile space/tier/idc, compatibility, constraints, level
+            const uint8_t tail[10] = {
+                    0xF0, 0x00, // min_spatial_segmentation_idc
+                    0xFC, // parallelismType
+                    0xFD, // chroma_format_idc 1
+                    0xF8, 0xF8, // bit depth luma/chroma 8
+                    0x00, 0x00, // avgFrameRate
+                    static_cast<uint8_t>(((rbsp[2] >> 1 & 0x07) + 1) << 3 | (rbsp[2] & 0x01) << 2 | 0x03),
+                    3 // numOfArrays
+            };
+            append(tag, tail, sizeof(tail));
+            const std::pair<uint8_t, const std::string *> arrays[3] = {{32, &vps_}, {33, &sps_}, {34, &pps_}};
+            for (const auto &array: arrays) {
+                tag.push_back(static_cast<char>(0x80 | array.first)); // array_completeness
+                append_be16(tag, 1);
+                append_be16(tag, array.second->size());
+                tag += *array.second;
+            }
+        }
+
+        static void set_body_size(std::string &tag) {
+            const size_t size = tag.size() - TAG_HEADER_SIZE;
+            tag[1] = static_cast<char>(size >> 16);
+            tag[2] = static_cast<char>(size >> 8);
+            tag[3] = static_cast<char>(size);
+        }
+
+        bool mux_aac(const EncodedShared &frame, FlvPacket &out) {
+            const uint8_t *data = frame.data;
+            size_t size = frame.size;
+            uint8_t object_type = config_.aac_object_type;
+            uint8_t freq_index = aac_frequency_index(config_.sample_rate);
+            uint8_t channels = config_.channels;
+
+            if (size >= 7 && data[0] == 0xFF && (data[1] & 0xF0) == 0xF0) {
+                object_type = static_cast<uint8_t>((data[2] >> 6) + 1);
+                freq_index = (data[2] >> 2) & 0x0F;
+                channels = static_cast<uint8_t>((data[2] & 0x01) << 2 | data[3] >> 6);
+                const size_t header = (data[1] & 0x01) ? 7 : 9; // protection_absent
+                if (size <= header) return false;
+                data += header;
+                size -= header;
+            }
+
+            // AudioSpecificConfig: object type (5) | frequency index (4) | channel configuration (4) | 000
+            const auto asc = static_cast<uint16_t>(object_type << 11 | freq_index << 7 | (channels & 0x0F) << 3);
+            if (!audio_config_ || asc != asc_) {
+                asc_ = asc;
+                auto tag = begin_tag(TAG_AUDIO, 0, 4);
+                tag->push_back(static_cast<char>(AAC_SOUND_FLAGS));
+                tag->push_back(0); // sequence header
+                append_be16(*tag, asc);
+                audio_config_ = finish(std::move(tag));
+                out.config = audio_config_;
+            }
+
+            auto tag = begin_tag(TAG_AUDIO, timestamp(Audio, frame.pts), 2 + size);
+            tag->push_back(static_cast<char>(AAC_SOUND_FLAGS));
+            tag->push_back(1); // raw
+            append(*tag, data, size);
+            out.tag = finish(std::move(tag));
+            return true;
+        }
+
+        bool mux_g711a(const EncodedShared &frame, FlvPacket &out) {
+            auto tag = begin_tag(TAG_AUDIO, timestamp(Audio, frame.pts), 1 + frame.size);
+            tag->push_back(0x72); // G.711 A-law, 8 kHz mono 16-bit by convention
+            append(*tag, frame.data, frame.size);
+            out.tag = finish(std::move(tag));
+            return true;
+        }
+
+        static int64_t now_ms() {
+            using namespace std::chrono;
+            return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+        }
+
+    private:
+        static constexpr uint8_t AAC_SOUND_FLAGS = 0xAF; // AAC, the rate/size/type bits are fixed for AAC
+
+        struct Anchor {
+            bool set{false};
+            int64_t pts{0};
+            int64_t offset_ms{0};
+        };
+
+        FlvConfig config_;
+
+        bool started_{false};
+        int64_t start_ms_{0};
+        Anchor anchors_[MAX_MEDIA_TRACK]{};
+
+        std::string vps_;
+        std::string sps_;
+        std::string pps_;
+        uint16_t asc_{0};
+        FlvTag video_config_;
+        FlvTag audio_config_;
+
+        std::vector<std::pair<const uint8_t *, size_t> > nals_;
+    };
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+
+#include "rtspx/rtp.h"
+
+namespace rtspx {
+    /*
+     * Lock-free latency histogram, log2 ranges split into 8 linear sub-buckets (about 12% resolution)
+     * from 1 us up to a few hours. record_us() only does relaxed atomics, so it can sit on the packetizing path of a
+     * session and be read from a stats thread.
+     */
+    class LatencyHistogram {
+    public:
+        LatencyHistogram() { reset(); }
+
+        LatencyHistogram(const LatencyHistogram &) = delete;
+
+        LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+        void record_us(int64_t us) {
+            if (us < 0) us = 0;
+            buckets_[bucket(static_cast<uint64_t>(us))].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            sum_us_.fetch_add(static_cast<uint64_t>(us), std::memory_order_relaxed);
+            uint64_t max = max_us_.load(std::memory_order_relaxed);
+            while (static_cast<uint64_t>(us) > max &&
+                   !max_us_.compare_exchange_weak(max, static_cast<uint64_t>(us), std::memory_order_relaxed)) {}
+        }
+
+        /// Delay from an NTP capture time (abs-capture-time clock) until now
+        void record_since(uint64_t capture_ntp) {
+            if (capture_ntp != 0) record_us(ntp_to_unix_us(ntp_now()) - ntp_to_unix_us(capture_ntp));
+        }
+
+        [[nodiscard]] uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] uint64_t max_us() const { return max_us_.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] uint64_t mean_us() const {
+            const uint64_t n = count();
+            return n == 0 ? 0 : sum_us_.load(std::memory_order_relaxed) / n;
+        }
+
+        /// Upper bound of the bucket holding the given percentile (0..100)
+        [[nodiscard]] uint64_t percentile_us(double percentile) const {
+            const uint64_t n = count();
+            if (n == 0) return 0;
+            auto rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(n) + 0.5);
+            if (rank < 1) rank = 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+                seen += buckets_[i].load(std::memory_order_relaxed);
+                if (seen >= rank) return std::min(upper_bound(i), max_us());
+            }
+            return max_us();
+        }
+
+        void reset() {
+            for (auto &b: buckets_) b.store(0, std::memory_order_relaxed);
+            count_.store(0, std::memory_order_relaxed);
+            sum_us_.store(0, std::memory_order_relaxed);
+            max_us_.store(0, std::memory_order_relaxed);
+        }
+
+        /// "n=.. mean=..ms p50=..ms p90=..ms p99=..ms max=..ms"
+        [[nodiscard]] std::string to_string() const {
+            char buf[160];
+            std::snprintf(buf, sizeof(buf), "n=%llu mean=%.1fms p50=%.1fms p90=%.1fms p99=%.1fms max=%.1fms",
+                          static_cast<unsigned long long>(count()), mean_us() / 1000.0, percentile_us(50) / 1000.0,
+                          percentile_us(90) / 1000.0, percentile_us(99) / 1000.0, max_us() / 1000.0);
+            return buf;
+        }
+
+    private:
+        static constexpr size_t SUB_BITS = 3;
+        static constexpr size_t SUB_BUCKETS = 1u << SUB_BITS;
+        static constexpr size_t NUM_RANGES = 32;
+        static constexpr size_t NUM_BUCKETS = NUM_RANGES * SUB_BUCKETS;
+
+        static size_t bucket(uint64_t us) {
+            if (us < SUB_BUCKETS) return static_cast<size_t>(us);
+            const size_t msb = 63u - static_cast<size_t>(__builtin_clzll(us));
+            const size_t range = msb - SUB_BITS + 1;
+            if (range >= NUM_RANGES) return NUM_BUCKETS - 1;
+            const auto sub = static_cast<size_t>((us >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+            return range * SUB_BUCKETS + sub;
+        }
+
+        static uint64_t upper_bound(size_t index) {
+            const size_t range = index / SUB_BUCKETS;
+            const size_t sub = index % SUB_BUCKETS;
+            if (range == 0) return sub;
+            const size_t shift = range - 1;
+            return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+        }
+
+    private:
+        std::atomic<uint64_t> buckets_[NUM_BUCKETS];
+        std::atomic<uint64_t> count_{0};
+        std::atomic<uint64_t> sum_us_{0};
+        std::atomic<uint64_t> max_us_{0};
+    };
+}
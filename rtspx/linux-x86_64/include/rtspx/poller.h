@@ -0,0 +1,357 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "rtspx/task_queue.h"
+
+namespace rtspx::net {
+    static inline int64_t now_ms() {
+        using namespace std::chrono;
+        return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Bind an even/odd UDP port pair for RTP/RTCP, ports[0] is even
+    static inline bool open_udp_pair(const std::string &ip, int fds[2], uint16_t ports[2]) {
+        static thread_local std::mt19937 rng(std::random_device{}());
+        std::uniform_int_distribution<int> dist(15000, 30000);
+
+        auto open_one = [&ip](uint16_t port) {
+            const int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0) return -1;
+
+            const int size = 1024 * 1024;
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = ip.empty() ? INADDR_ANY : ::inet_addr(ip.c_str());
+            if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+                ::close(fd);
+                return -1;
+            }
+            return fd;
+        };
+
+        for (int attempt = 0; attempt < 16; ++attempt) {
+            const auto port = static_cast<uint16_t>(dist(rng) * 2);
+            fds[0] = open_one(port);
+            if (fds[0] < 0) continue;
+            fds[1] = open_one(port + 1);
+            if (fds[1] < 0) {
+                ::close(fds[0]);
+                continue;
+            }
+            ports[0] = port;
+            ports[1] = port + 1;
+            return true;
+        }
+        fds[0] = fds[1] = -1;
+        return false;
+    }
+
+    /*
+     * Single-thread epoll loop for the header-only network components (relay, client).
+     * It is independent from the EventLoop inside librtspx.
+     *
+     * add/modify/remove and timers must be called from the loop thread (or before start()),
+     * post() is the only thread-safe entry. Posted tasks go through a lock-free MPSC ring of inline
+     * callables and the eventfd is only written when the loop is (about to be) blocked in epoll_wait,
+     * so a burst of posts from many producer threads costs one wakeup syscall.
+     *
+     * Handlers live in a table indexed by fd; the epoll data carries fd and a generation so events of a fd
+     * removed (or closed and reused) earlier in the same batch are dropped. Pass EPOLLET in events for
+     * edge-triggered sockets, their handler must then read/write until EAGAIN.
+     *
+     * stop() may be called from a handler, destroying the Poller there aborts: hand the owner to another thread.
+     */
+    class PollHandler {
+    public:
+        virtual ~PollHandler() = default;
+
+        virtual void on_poll_events(uint32_t events) = 0;
+    };
+
+    class Poller {
+    public:
+        using EventCallback = std::function<void(uint32_t events)>;
+        using Task = InlineTask;
+        using TimerCallback = std::function<bool()>; // return false to cancel
+
+        explicit Poller(size_t task_capacity = 4096, int max_events = 512)
+                : events_(std::max(max_events, 16)), tasks_(task_capacity) {
+            epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+            wakeup_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            slots_.reserve(1024);
+
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u64 = static_cast<uint32_t>(wakeup_fd_);
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &ev);
+        }
+
+        ~Poller() {
+            // the loop keeps using this object after the handler returns, so that would be a use-after-free
+            if (thread_.joinable() && in_loop_thread()) {
+                std::fprintf(stderr, "rtspx::net::Poller destroyed on its own loop thread, post() the teardown "
+                                     "to another thread\n");
+                std::abort();
+            }
+            stop();
+            if (wakeup_fd_ >= 0) ::close(wakeup_fd_);
+            if (epoll_fd_ >= 0) ::close(epoll_fd_);
+        }
+
+        Poller(const Poller &) = delete;
+
+        Poller &operator=(const Poller &) = delete;
+
+        bool start() {
+            if (epoll_fd_ < 0 || wakeup_fd_ < 0) return false;
+            if (running_.exchange(true)) return true;
+            // stopped and restarted from a handler: the current loop simply keeps running
+            if (in_loop_thread()) return true;
+            // a loop stopped from its own thread exits by itself, reap it before starting a new one
+            if (thread_.joinable()) thread_.join();
+            thread_ = std::thread(&Poller::loop, this);
+            return true;
+        }
+
+        /// From a handler the loop exits after the current batch, its thread is joined by a later stop()/start()
+        void stop() {
+            if (running_.exchange(false)) write_wakeup();
+            if (thread_.joinable() && thread_.get_id() != std::this_thread::get_id()) thread_.join();
+        }
+
+        [[nodiscard]] bool is_running() const { return running_.load(); }
+
+        [[nodiscard]] bool in_loop_thread() const { return std::this_thread::get_id() == thread_.get_id(); }
+
+        /// Dispatch to handler by raw pointer, the owner keeps it alive until remove(fd)
+        bool add(int fd, uint32_t events, PollHandler *handler) {
+            if (handler == nullptr || !attach(fd, events)) return false;
+            slots_[fd].handler = handler;
+            return true;
+        }
+
+        bool add(int fd, uint32_t events, EventCallback cb) {
+            if (!attach(fd, events)) return false;
+            slots_[fd].cb = std::make_unique<EventCallback>(std::move(cb));
+            return true;
+        }
+
+        bool modify(int fd, uint32_t events) {
+            if (!is_added(fd)) return false;
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.u64 = key(fd);
+            return ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+        }
+
+        void remove(int fd) {
+            if (!is_added(fd)) return;
+            ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+            Slot &slot = slots_[fd];
+            slot.handler = nullptr;
+            // the callback may be the one running right now, free it after the batch
+            if (slot.cb) retired_.push_back(std::move(slot.cb));
+        }
+
+        [[nodiscard]] bool is_added(int fd) const {
+            return fd >= 0 && static_cast<size_t>(fd) < slots_.size() &&
+                   (slots_[fd].handler != nullptr || slots_[fd].cb != nullptr);
+        }
+
+        /// Run task on the loop thread
+        void post(Task task) {
+            // keep FIFO order while older tasks still wait in the overflow list
+            if (num_overflow_.load(std::memory_order_acquire) != 0 || !tasks_.push(std::move(task))) {
+                std::lock_guard<std::mutex> lock(overflow_mutex_);
+                overflow_.push_back(std::move(task));
+                num_overflow_.fetch_add(1, std::memory_order_release);
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst); // pairs with the fence in loop()
+            if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false, std::memory_order_acq_rel)) {
+                write_wakeup();
+            }
+        }
+
+        /// eventfd writes so far, for checking that wakeups are coalesced
+        [[nodiscard]] uint64_t num_wakeups() const { return num_wakeups_.load(std::memory_order_relaxed); }
+
+        uint32_t add_timer(uint32_t interval_ms, TimerCallback cb) {
+            const uint32_t id = ++last_timer_id_;
+            timers_[id] = Timer{interval_ms, now_ms() + interval_ms, std::move(cb)};
+            return id;
+        }
+
+        void remove_timer(uint32_t id) { timers_.erase(id); }
+
+    private:
+        struct Timer {
+            uint32_t interval_ms{};
+            int64_t expire_ms{};
+            TimerCallback cb{};
+        };
+
+        struct Slot {
+            uint32_t generation{0};
+            PollHandler *handler{nullptr};
+            std::unique_ptr<EventCallback> cb{};
+        };
+
+        [[nodiscard]] uint64_t key(int fd) const {
+            return (static_cast<uint64_t>(slots_[fd].generation) << 32) | static_cast<uint32_t>(fd);
+        }
+
+        bool attach(int fd, uint32_t events) {
+            if (fd < 0 || is_added(fd)) return false;
+            if (static_cast<size_t>(fd) >= slots_.size()) slots_.resize(fd + 1);
+            ++slots_[fd].generation;
+
+            epoll_event ev{};
+            ev.events = events;
+            ev.data.u64 = key(fd);
+            return ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == 0;
+        }
+
+        void dispatch(const epoll_event &event) {
+            const auto fd = static_cast<int>(event.data.u64 & 0xFFFFFFFF);
+            if (fd == wakeup_fd_) {
+                uint64_t value = 0;
+                [[maybe_unused]] const ssize_t r = ::read(wakeup_fd_, &value, sizeof(value));
+                return;
+            }
+            if (!is_added(fd)) return;
+
+            const Slot &slot = slots_[fd];
+            if (slot.generation != static_cast<uint32_t>(event.data.u64 >> 32)) return; // stale, fd was reused
+            // the slot reference dies if the handler adds fds and slots_ grows, call through a copy
+            if (slot.handler != nullptr) {
+                PollHandler *handler = slot.handler;
+                handler->on_poll_events(event.events);
+            } else {
+                EventCallback *cb = slot.cb.get();
+                (*cb)(event.events);
+            }
+        }
+
+        void write_wakeup() {
+            const uint64_t one = 1;
+            [[maybe_unused]] const ssize_t n = ::write(wakeup_fd_, &one, sizeof(one));
+            num_wakeups_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] bool has_tasks() const {
+            return !tasks_.empty() || num_overflow_.load(std::memory_order_acquire) != 0;
+        }
+
+        int next_timeout() const {
+            if (timers_.empty()) return 100;
+            int64_t nearest = INT64_MAX;
+            for (const auto &kv: timers_) nearest = std::min(nearest, kv.second.expire_ms);
+            const int64_t wait = nearest - now_ms();
+            return wait <= 0 ? 0 : static_cast<int>(std::min<int64_t>(wait, 100));
+        }
+
+        void run_tasks() {
+            // bounded, tasks posted from inside a task run on the next iteration
+            Task task;
+            for (size_t i = tasks_.capacity(); i > 0 && tasks_.pop(task); --i) {
+                task();
+                task.reset();
+            }
+
+            if (num_overflow_.load(std::memory_order_acquire) == 0) return;
+            std::vector<Task> overflow;
+            {
+                std::lock_guard<std::mutex> lock(overflow_mutex_);
+                overflow.swap(overflow_);
+            }
+            // drain what was queued in the ring before the overflow started
+            while (tasks_.pop(task)) {
+                task();
+                task.reset();
+            }
+            for (auto &t: overflow) t();
+            num_overflow_.fetch_sub(overflow.size(), std::memory_order_release);
+        }
+
+        void run_timers() {
+            const int64_t now = now_ms();
+            std::vector<uint32_t> expired;
+            for (const auto &kv: timers_) {
+                if (kv.second.expire_ms <= now) expired.push_back(kv.first);
+            }
+            for (const uint32_t id: expired) {
+                auto it = timers_.find(id);
+                if (it == timers_.end()) continue; // removed by an earlier callback
+                auto cb = it->second.cb;
+                if (!cb()) {
+                    timers_.erase(id);
+                    continue;
+                }
+                it = timers_.find(id);
+                if (it != timers_.end()) it->second.expire_ms = now + it->second.interval_ms;
+            }
+        }
+
+        void loop() {
+            const int max_events = static_cast<int>(events_.size());
+            while (running_.load(std::memory_order_acquire)) {
+                // announce the sleep before the last look at the queue, producers write the eventfd only then
+                sleeping_.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                const int timeout = has_tasks() ? 0 : next_timeout();
+                const int n = ::epoll_wait(epoll_fd_, events_.data(), max_events, timeout);
+                sleeping_.store(false, std::memory_order_relaxed);
+                for (int i = 0; i < n; ++i) dispatch(events_[i]);
+                run_tasks();
+                run_timers();
+                retired_.clear();
+            }
+            run_tasks();
+        }
+
+    private:
+        int epoll_fd_{-1};
+        int wakeup_fd_{-1};
+        std::thread thread_;
+        std::atomic<bool> running_{false};
+
+        std::vector<Slot> slots_;
+        std::vector<epoll_event> events_;
+        std::vector<std::unique_ptr<EventCallback> > retired_;
+
+        MpscTaskRing tasks_;
+        std::atomic<bool> sleeping_{false};
+        std::atomic<uint64_t> num_wakeups_{0};
+
+        std::mutex overflow_mutex_;
+        std::vector<Task> overflow_;
+        std::atomic<size_t> num_overflow_{0};
+
+        uint32_t last_timer_id_{0};
+        std::map<uint32_t, Timer> timers_;
+    };
+}
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+
+#include "rtspx/sessionx.h"
+
+namespace rtspx {
+    struct RenditionSwitcherConfig {
+        size_t queue_high{32}; // consumer queue depth (frames/packets) that forces a switch down
+        size_t queue_low{4}; // switch up only with the queue at or below this
+        double queue_growth{2.0}; // smoothed queue growth (frames/packets per second) that counts as growing
+        double block_high{0.5}; // blocked share of the report interval that, with a growing queue, means congestion
+        double block_low{0.05}; // switch up only while the sender is blocked less than this share
+        uint32_t down_hold_ms{2000}; // no further switch down within this time, the last one still has to take effect
+        uint32_t up_hold_ms{10000}; // stable time needed before a switch up, doubled (up to 16x) after a failed one
+        size_t audio_rendition{0}; // audio is taken from one rendition and never switches, its clock drives the output
+        bool shared_clock{true}; // renditions carry the same capture pts/RTP time, false rebases both on switches
+        uint32_t pts_rate{90000}; // pts ticks per second, for rebasing with shared_clock = false
+        uint32_t clock_rate{90000}; // RTP clock of the video track, for rebasing with shared_clock = false
+    };
+
+    /*
+     * Adaptive bitrate for plain RTSP/HTTP viewers: several renditions of one source (main/sub stream)
+     * go in, one continuous stream comes out through the sink.
+     *
+     * The consumer reports its send queue depth and how long its sender was blocked (socket not writable)
+     * with report(), the switcher picks a target rendition and swaps at the next keyframe of the target, so the
+     * decoder never sees a broken GOP. Delivered bytes are deliberately not used: a viewer can never receive
+     * more than the current rendition produces, so they say nothing about spare capacity. A queue that keeps
+     * growing while the sender is mostly blocked steps down one rendition; a queue at or below queue_low with
+     * the sender almost never blocked for up_hold_ms steps up one rendition. A viewer with a flat queue that
+     * is blocked part of the time (link saturated but keeping up) stays where it is.
+     *
+     * Feed the sink into a MediaSession (one adaptive url next to the fixed main/sub urls, SSRC, seq and
+     * RTP timestamps then stay continuous because the session keeps packetizing) or into a per-viewer
+     * connection for per-client switching, as HttpFlvServer::add_adaptive_stream does for HTTP-FLV viewers.
+     *
+     * Rendition rates are measured from the pushed frames, until all are measured the index order is taken as
+     * lowest rate first. push()/report() are thread-safe, the sink runs
+     * on the pushing thread.
+     */
+    class RenditionSwitcher {
+    public:
+        using FrameSink = std::function<void(MediaTrack track, const EncodedShared &frame)>;
+
+        RenditionSwitcher(size_t count, FrameSink sink, const RenditionSwitcherConfig &config = {})
+                : config_(config), sink_(std::move(sink)), renditions_(std::max<size_t>(count, 1)) {
+            if (config_.audio_rendition >= renditions_.size()) config_.audio_rendition = 0;
+        }
+
+        RenditionSwitcher(const RenditionSwitcher &) = delete;
+
+        RenditionSwitcher &operator=(const RenditionSwitcher &) = delete;
+
+        void push(size_t index, MediaTrack track, const EncodedShared &frame) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (index >= renditions_.size()) return;
+
+            if (track == Audio) {
+                if (index != config_.audio_rendition) return;
+                lock.unlock();
+                if (sink_) sink_(track, frame);
+                return;
+            }
+
+            Rendition &rendition = renditions_[index];
+            const int64_t now = now_ms();
+            measure(rendition, frame.size, now);
+
+            if (index == target_ && index != current_ && frame.frame_type == VIDEO_FRAME_I) {
+                rebase(index, frame, now);
+                if (current_ != npos) ++num_switches_;
+                current_ = index;
+            }
+            rendition.last_pts = frame.pts;
+            rendition.last_rtp = frame.rtp_timestamp;
+            rendition.last_ms = now;
+            if (index != current_) return;
+
+            EncodedShared out = frame;
+            out.pts = frame.pts + pts_offset_;
+            out.rtp_timestamp = frame.rtp_timestamp + rtp_offset_;
+            if (has_out_) {
+                last_delta_ = out.pts - last_out_pts_;
+                last_rtp_delta_ = out.rtp_timestamp - last_out_rtp_;
+            }
+            last_out_pts_ = out.pts;
+            last_out_rtp_ = out.rtp_timestamp;
+            has_out_ = true;
+
+            lock.unlock();
+            if (sink_) sink_(track, out);
+        }
+
+        /*
+         * Consumer side measurement, called periodically (e.g. every 200-1000 ms): frames/packets waiting to be
+         * sent and the milliseconds the sender spent blocked (socket not writable / EAGAIN) since the last report.
+         */
+        void report(size_t queue_depth, uint32_t blocked_ms) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const int64_t now = now_ms();
+            if (last_report_ms_ == 0) {
+                last_report_ms_ = now;
+                last_depth_ = queue_depth;
+                stable_since_ms_ = now;
+                return;
+            }
+            const int64_t interval = now - last_report_ms_;
+            if (interval <= 0) return;
+            const double growth = (static_cast<double>(queue_depth) - static_cast<double>(last_depth_)) * 1000.0 /
+                                  static_cast<double>(interval);
+            growth_ = (growth_ + growth) / 2;
+            const double blocked = std::min(static_cast<double>(blocked_ms) / static_cast<double>(interval), 1.0);
+            last_report_ms_ = now;
+            last_depth_ = queue_depth;
+
+            // renditions by measured rate, lowest first; index order until every rendition has been measured
+            std::vector<size_t> order(renditions_.size());
+            for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+            if (std::all_of(renditions_.begin(), renditions_.end(), [](const Rendition &r) {
+                return r.bytes_per_sec > 0;
+            })) {
+                std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+                    return renditions_[a].bytes_per_sec < renditions_[b].bytes_per_sec;
+                });
+            }
+            // decide from the target, a pending switch counts as done
+            const auto rank = static_cast<size_t>(std::find(order.begin(), order.end(), target_) - order.begin());
+
+            const bool congested = queue_depth >= config_.queue_high ||
+                                   (growth_ >= config_.queue_growth && blocked >= config_.block_high);
+            if (congested) {
+                stable_since_ms_ = now;
+                if (rank == 0 || now - last_down_ms_ < static_cast<int64_t>(config_.down_hold_ms)) return;
+                // the last step up did not hold: wait longer before trying it again
+                if (last_up_ms_ != 0 && now - last_up_ms_ < up_hold_ms_) {
+                    up_hold_ms_ = std::min<int64_t>(up_hold_ms_ * 2, static_cast<int64_t>(config_.up_hold_ms) * 16);
+                }
+                target_ = order[rank - 1]; // one step at a time, the queue shows the effect only after a keyframe
+                last_down_ms_ = now;
+                last_up_ms_ = 0;
+                return;
+            }
+
+            if (queue_depth > config_.queue_low || blocked > config_.block_low) {
+                stable_since_ms_ = now;
+                return;
+            }
+            if (last_up_ms_ != 0 && now - last_up_ms_ >= up_hold_ms_) up_hold_ms_ = config_.up_hold_ms; // it held
+            if (rank + 1 >= order.size() || now - stable_since_ms_ < up_hold_ms_) return;
+            target_ = order[rank + 1];
+            last_up_ms_ = now;
+            stable_since_ms_ = now;
+        }
+
+        /// Pin a rendition (e.g. operator choice), applied at its next keyframe
+        void request(size_t index) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (index < renditions_.size()) target_ = index;
+        }
+
+        /// Rendition currently forwarded, npos until the first keyframe
+        [[nodiscard]] size_t current() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return current_;
+        }
+
+        [[nodiscard]] size_t target() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return target_;
+        }
+
+        /// Measured rate of a rendition in bytes/s
+        [[nodiscard]] uint64_t byte_rate(size_t index) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return index < renditions_.size() ? renditions_[index].bytes_per_sec : 0;
+        }
+
+        [[nodiscard]] uint64_t num_switches() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return num_switches_;
+        }
+
+        static constexpr size_t npos = static_cast<size_t>(-1);
+
+    private:
+        struct Rendition {
+            uint64_t bytes_per_sec{0}; // smoothed per 1 s window
+            uint64_t window_bytes{0};
+            int64_t window_start_ms{0};
+            int64_t last_pts{0}; // last video frame, its arrival time maps the clock onto the others
+            uint32_t last_rtp{0};
+            int64_t last_ms{0};
+        };
+
+        /*
+         * Offsets for switching to rendition index at keyframe frame. The output runs on the clock of the audio
+         * rendition, so audio is forwarded untouched and stays in sync: with separate clocks the new rendition is
+         * mapped onto it through the arrival time of the audio rendition's latest video frame (continuity with
+         * the last output when that rendition has no video yet). Pts and RTP time then never go backwards and
+         * never repeat, a repeated RTP timestamp would merge two access units.
+         */
+        void rebase(size_t index, const EncodedShared &frame, int64_t now) {
+            const Rendition &anchor = renditions_[config_.audio_rendition];
+            if (config_.shared_clock || index == config_.audio_rendition) {
+                pts_offset_ = 0;
+                rtp_offset_ = 0;
+            } else if (anchor.last_ms != 0) {
+                const int64_t elapsed = now - anchor.last_ms;
+                pts_offset_ = anchor.last_pts + elapsed * config_.pts_rate / 1000 - frame.pts;
+                rtp_offset_ = anchor.last_rtp + static_cast<uint32_t>(elapsed * config_.clock_rate / 1000) -
+                              frame.rtp_timestamp;
+            } else if (has_out_) {
+                pts_offset_ = last_out_pts_ + std::max<int64_t>(last_delta_, 1) - frame.pts;
+                rtp_offset_ = last_out_rtp_ + std::max<int32_t>(static_cast<int32_t>(last_rtp_delta_), 1) -
+                              frame.rtp_timestamp;
+            }
+            if (!has_out_) return;
+            if (frame.pts + pts_offset_ <= last_out_pts_) pts_offset_ = last_out_pts_ + 1 - frame.pts;
+            if (static_cast<int32_t>(frame.rtp_timestamp + rtp_offset_ - last_out_rtp_) <= 0) {
+                rtp_offset_ = last_out_rtp_ + 1 - frame.rtp_timestamp;
+            }
+        }
+
+        static void measure(Rendition &rendition, size_t size, int64_t now) {
+            if (rendition.window_start_ms == 0) rendition.window_start_ms = now;
+            rendition.window_bytes += size;
+
+            const int64_t elapsed = now - rendition.window_start_ms;
+            if (elapsed < 1000) return;
+            const uint64_t rate = rendition.window_bytes * 1000 / static_cast<uint64_t>(elapsed);
+            rendition.bytes_per_sec = rendition.bytes_per_sec == 0 ? rate : (rendition.bytes_per_sec * 3 + rate) / 4;
+            rendition.window_bytes = 0;
+            rendition.window_start_ms = now;
+        }
+
+        static int64_t now_ms() {
+            using namespace std::chrono;
+            return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+        }
+
+    private:
+        RenditionSwitcherConfig config_;
+        FrameSink sink_;
+
+        mutable std::mutex mutex_;
+        std::vector<Rendition> renditions_;
+        size_t current_{npos};
+        size_t target_{0};
+        int64_t last_report_ms_{0};
+        size_t last_depth_{0};
+        double growth_{0};
+        int64_t stable_since_ms_{0};
+        int64_t last_down_ms_{0};
+        int64_t last_up_ms_{0};
+        int64_t up_hold_ms_{config_.up_hold_ms};
+        uint64_t num_switches_{0};
+
+        int64_t pts_offset_{0};
+        uint32_t rtp_offset_{0}; // modulo 2^32 like the RTP timestamps
+        int64_t last_out_pts_{0};
+        int64_t last_delta_{0};
+        uint32_t last_out_rtp_{0};
+        uint32_t last_rtp_delta_{0};
+        bool has_out_{false};
+    };
+}
@@ -0,0 +1,460 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+#include "vcodecx/rga.h"
+#include "vcodecx/manager.h"
+
+namespace vcodecx {
+    struct BatchConfig {
+        int batch_size{4};
+        int width{640};
+        int height{640};
+        ImageFormat format{ImageFormat::RGB24}; // 张量格式 NHWC uint8：RGB24 / BGR24 / RGBA32 / BGRA32
+        int deadline_ms{40}; // 批里第一帧到达后最多等多久，超时交付不满的批
+        int pool_size{3}; // 批缓冲个数，全部被下游持有时丢帧
+        uint8_t pad_value{114};
+        bool use_rga{true}; // aarch64 上优先用 RGA 缩放，条件不满足或失败时退回 CPU
+    };
+
+    /// 批中一个槽位对应的帧信息，scale / pad 用于把检测框映射回原图
+    struct BatchSlot {
+        std::string stream_id{};
+        int64_t pts{};
+        uint32_t timestamp{};
+        int src_width{};
+        int src_height{};
+        float scale{};
+        int pad_x{};
+        int pad_y{};
+    };
+
+    struct BatchX {
+        int width{};
+        int height{};
+        ImageFormat format{};
+        int capacity{}; // batch_size，不满的批后面的槽位内容无效
+        size_t slot_size{}; // 每个槽位字节数，槽位 i 起始于 ptr + i * slot_size
+        int fd{-1}; // dma-heap 分配时有效，可直接交给 NPU
+        void *ptr{nullptr};
+        std::vector<BatchSlot> slots{}; // 有效槽位，按槽位顺序
+        std::shared_ptr<void> holder{}; // 最后一个引用释放时批缓冲回到池中
+
+        [[nodiscard]] uint8_t *slot(const int i) const { return static_cast<uint8_t *>(ptr) + i * slot_size; }
+    };
+
+    /*
+     * 多路解码帧拼批：注册若干路流，解码帧直接 letterbox 到池化（aarch64 上为 DMA）批缓冲的槽位里，
+     * 凑满 batch_size 或第一帧等待超过 deadline_ms 时交付，省掉逐帧拷贝到 batch 的一步。
+     * 同一路流在一个批里只占一个槽位，来得快的流用新帧覆盖旧帧，避免一路流占满整批。
+     * 回调在凑满批的解码线程或超时线程上执行，不要在回调里长时间阻塞。可以在回调里 stop()，
+     * 但超时线程上的回调不能放掉 Batcher 的最后一个引用（析构会等这个线程退出），这种情况直接 abort。
+     */
+    class Batcher : public std::enable_shared_from_this<Batcher> {
+    public:
+        using Callback = std::function<void(const std::shared_ptr<BatchX> &)>;
+
+        Batcher(std::shared_ptr<Manager> manager, std::vector<std::string> stream_ids, const BatchConfig &config,
+                Callback cb)
+                : manager_(std::move(manager)), stream_ids_(std::move(stream_ids)), config_(config),
+                  callback_(std::move(cb)), pool_(std::make_shared<FramePool>(config.pool_size, PoolExhaust::Drop)) {
+            config_.batch_size = std::max(config_.batch_size, 1);
+            slot_size_ = static_cast<size_t>(config_.width) * config_.height * pixel_bytes(config_.format);
+#if VCODECX_HAS_DMA
+            if (config_.use_rga) rga_ = rockchip::RgaX::instance();
+#endif
+        }
+
+        ~Batcher() {
+            if (flusher_.joinable() && flusher_.get_id() == std::this_thread::get_id()) {
+                std::fprintf(stderr, "vcodecx::Batcher destroyed in its own batch callback, "
+                                     "keep a reference until the callback returns\n");
+                std::abort();
+            }
+            stop();
+        }
+
+        Batcher(const Batcher &) = delete;
+
+        Batcher &operator=(const Batcher &) = delete;
+
+        /// 订阅各路解码器并启动超时线程，订阅只持有对 Batcher 的弱引用
+        bool start() {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            if (running_) return true;
+            if (slot_size_ == 0) return false;
+            if (flusher_.joinable()) {
+                // 上一轮在超时线程的回调里 stop()，那时没法 join 自己
+                if (flusher_.get_id() == std::this_thread::get_id()) return false;
+                flusher_.join();
+            }
+
+            {
+                std::lock_guard<std::mutex> batch_lock(mutex_);
+                running_ = true;
+            }
+            std::weak_ptr<Batcher> weak = weak_from_this();
+            for (const auto &id: stream_ids_) {
+                if (!manager_) break;
+                const int subscribe_id = manager_->subscribe_decoder(id, [weak](const std::shared_ptr<FrameX> &f) {
+                    if (auto self = weak.lock()) self->push(f);
+                });
+                if (subscribe_id >= 0) subscriptions_.emplace_back(id, subscribe_id);
+            }
+            flusher_ = std::thread([this] { run(); });
+            return true;
+        }
+
+        /// 取消订阅并停止超时线程，未交付的批被丢弃；在超时线程的回调里调用时线程在回调返回后退出
+        void stop() {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            if (running_) {
+                for (const auto &subscription: subscriptions_) {
+                    manager_->unsubscribe_decoder(subscription.first, subscription.second);
+                }
+                subscriptions_.clear();
+                {
+                    std::lock_guard<std::mutex> batch_lock(mutex_);
+                    running_ = false;
+                    current_.reset();
+                    slots_.clear();
+                }
+                cv_.notify_all();
+            }
+            // 不分离：线程还要访问 this，留到下次 start() 或析构时回收
+            if (flusher_.joinable() && flusher_.get_id() != std::this_thread::get_id()) flusher_.join();
+        }
+
+        /*
+         * 放入一帧（start() 之后也可不经 Manager 直接调用），格式不支持或批缓冲耗尽时丢弃并返回 false。
+         * YUV 源只能走 RGA，letterbox 条件不满足（左右留边、行宽不对齐）时丢弃；RGA 执行出错时槽位填 pad_value。
+         */
+        bool push(const std::shared_ptr<FrameX> &frame) {
+            if (!frame || frame->ptr == nullptr || frame->width <= 0 || frame->height <= 0) {
+                num_dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            BatchSlot meta;
+            meta.stream_id = frame->stream_id;
+            meta.pts = frame->pts;
+            meta.timestamp = frame->timestamp;
+            meta.src_width = frame->width;
+            meta.src_height = frame->height;
+            meta.scale = std::min(static_cast<float>(config_.width) / frame->width,
+                                  static_cast<float>(config_.height) / frame->height);
+            meta.pad_x = (config_.width - scaled_width(meta)) / 2;
+            meta.pad_y = (config_.height - scaled_height(meta)) / 2;
+            if (!supported(*frame, meta)) {
+                num_dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            std::shared_ptr<PoolBuffer> buffer;
+            int index;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                // 批已满但还有槽位在写入时，等它交付后进下一批
+                cv_.wait(lock, [&] {
+                    return !running_ || !current_ || static_cast<int>(slots_.size()) < config_.batch_size ||
+                           std::any_of(slots_.begin(), slots_.end(), [&](const BatchSlot &slot) {
+                               return slot.stream_id == meta.stream_id;
+                           });
+                });
+                if (!running_) return false;
+                if (!current_) {
+                    current_ = pool_->acquire(slot_size_ * config_.batch_size, 0);
+                    if (!current_) {
+                        num_dropped_.fetch_add(1, std::memory_order_relaxed);
+                        return false;
+                    }
+                    first_ = std::chrono::steady_clock::now();
+                    cv_.notify_all();
+                }
+                const auto it = std::find_if(slots_.begin(), slots_.end(), [&](const BatchSlot &slot) {
+                    return slot.stream_id == meta.stream_id;
+                });
+                index = static_cast<int>(it - slots_.begin());
+                if (it == slots_.end()) {
+                    slots_.push_back(meta);
+                } else {
+                    *it = meta;
+                    num_replaced_.fetch_add(1, std::memory_order_relaxed);
+                }
+                buffer = current_;
+                ++writers_;
+            }
+
+            uint8_t *slot = static_cast<uint8_t *>(buffer->ptr) + index * slot_size_;
+            if (!letterbox_rga(*frame, meta, slot, *buffer)) {
+                if (pixel_bytes(frame->format) != 0) {
+                    letterbox_cpu(*frame, meta, slot);
+                } else {
+                    // 槽位已经占了，填成空白图而不是留下上一批的内容
+                    fill_rows(slot, 0, config_.height);
+                    num_dropped_.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            std::shared_ptr<BatchX> batch;
+            bool idle;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                idle = --writers_ == 0;
+                const bool full = static_cast<int>(slots_.size()) >= config_.batch_size;
+                if (idle && current_ == buffer && (full || expired())) batch = take();
+            }
+            if (idle) cv_.notify_all();
+            if (batch) deliver(batch);
+            return true;
+        }
+
+        [[nodiscard]] const BatchConfig &config() const { return config_; }
+
+        [[nodiscard]] uint64_t num_batches() const { return num_batches_.load(std::memory_order_relaxed); }
+
+        /// 格式不支持、RGA 处理不了或批缓冲全部被下游持有而丢掉的帧
+        [[nodiscard]] uint64_t num_dropped() const { return num_dropped_.load(std::memory_order_relaxed); }
+
+        /// 同一路流在一个批里被新帧覆盖的次数
+        [[nodiscard]] uint64_t num_replaced() const { return num_replaced_.load(std::memory_order_relaxed); }
+
+        static std::shared_ptr<Batcher> create(
+                std::shared_ptr<Manager> manager, std::vector<std::string> stream_ids, const BatchConfig &config,
+                Callback cb
+        ) {
+            auto batcher = std::make_shared<Batcher>(std::move(manager), std::move(stream_ids), config, std::move(cb));
+            return batcher->start() ? batcher : nullptr;
+        }
+
+    private:
+        static int pixel_bytes(const ImageFormat fmt) {
+            switch (fmt) {
+                case ImageFormat::RGB24:
+                case ImageFormat::BGR24:
+                    return 3;
+                case ImageFormat::RGBA32:
+                case ImageFormat::BGRA32:
+                    return 4;
+                default:
+                    return 0;
+            }
+        }
+
+        /// 打包 RGB 类格式中 R/G/B 的字节位置
+        static void channel_order(const ImageFormat fmt, int order[3]) {
+            const bool bgr = fmt == ImageFormat::BGR24 || fmt == ImageFormat::BGRA32;
+            order[0] = bgr ? 2 : 0;
+            order[1] = 1;
+            order[2] = bgr ? 0 : 2;
+        }
+
+        /// 打包 RGB 源总能走 CPU，其他格式要 RGA 能直接 letterbox
+        [[nodiscard]] bool supported(const FrameX &frame, const BatchSlot &meta) const {
+            return pixel_bytes(frame.format) != 0 || rga_applicable(frame, meta);
+        }
+
+        /// letterbox_rga() 的前提：左右不留边，目标行宽和源宽 64 字节对齐，源格式 RGA 支持
+        [[nodiscard]] bool rga_applicable(const FrameX &frame, const BatchSlot &meta) const {
+#if VCODECX_HAS_DMA
+            if (!rga_ || meta.pad_x != 0 || row_bytes() % 64 != 0) return false;
+            const int luma_bytes = pixel_bytes(frame.format) == 0 ? 1 : pixel_bytes(frame.format);
+            return image_format_to_rgafmt(frame.format) != RK_FORMAT_UNKNOWN &&
+                   rockchip::is_aligned(frame.width, luma_bytes, 64);
+#else
+            (void) frame;
+            (void) meta;
+            return false;
+#endif
+        }
+
+        bool expired() const {
+            return std::chrono::steady_clock::now() - first_ >= std::chrono::milliseconds(config_.deadline_ms);
+        }
+
+        /// 调用时持有 mutex_
+        std::shared_ptr<BatchX> take() {
+            auto batch = std::make_shared<BatchX>();
+            batch->width = config_.width;
+            batch->height = config_.height;
+            batch->format = config_.format;
+            batch->capacity = config_.batch_size;
+            batch->slot_size = slot_size_;
+            batch->fd = current_->fd;
+            batch->ptr = current_->ptr;
+            batch->slots = std::move(slots_);
+            current_->sync_cpu_to_device();
+            batch->holder = std::move(current_);
+            current_.reset();
+            slots_.clear();
+            cv_.notify_all();
+            return batch;
+        }
+
+        void deliver(const std::shared_ptr<BatchX> &batch) {
+            num_batches_.fetch_add(1, std::memory_order_relaxed);
+            if (callback_) callback_(batch);
+        }
+
+        /// 超时线程：交付等待超过 deadline_ms 的不满批，写入中的槽位由最后一个写入者交付
+        void run() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (running_) {
+                if (!current_ || writers_ > 0) {
+                    cv_.wait(lock);
+                    continue;
+                }
+                const auto deadline = first_ + std::chrono::milliseconds(config_.deadline_ms);
+                if (std::chrono::steady_clock::now() < deadline) {
+                    cv_.wait_until(lock, deadline);
+                    continue;
+                }
+                auto batch = take();
+                lock.unlock();
+                deliver(batch);
+                lock.lock();
+            }
+        }
+
+        void fill_rows(uint8_t *dst, const int y0, const int y1) const {
+            if (y1 > y0) std::memset(dst + y0 * row_bytes(), config_.pad_value, (y1 - y0) * row_bytes());
+        }
+
+        [[nodiscard]] size_t row_bytes() const {
+            return static_cast<size_t>(config_.width) * pixel_bytes(config_.format);
+        }
+
+        /// 双线性缩放打包 RGB 源到槽位，边缘填 pad_value
+        void letterbox_cpu(const FrameX &frame, const BatchSlot &meta, uint8_t *dst) const {
+            const int src_bpp = pixel_bytes(frame.format);
+            const int dst_bpp = pixel_bytes(config_.format);
+            const int scaled_w = scaled_width(meta);
+            const int scaled_h = scaled_height(meta);
+            int src_order[3];
+            int dst_order[3];
+            channel_order(frame.format, src_order);
+            channel_order(config_.format, dst_order);
+
+            fill_rows(dst, 0, meta.pad_y);
+            fill_rows(dst, meta.pad_y + scaled_h, config_.height);
+
+            // 源坐标按 11 位定点小数，像素中心对齐
+            constexpr int SHIFT = 11;
+            constexpr int ONE = 1 << SHIFT;
+            std::vector<int> x0(scaled_w);
+            std::vector<int> fx(scaled_w);
+            for (int x = 0; x < scaled_w; ++x) {
+                const float sx = std::max((x + 0.5f) * frame.width / scaled_w - 0.5f, 0.0f);
+                x0[x] = std::min(static_cast<int>(sx), frame.width - 1);
+                fx[x] = static_cast<int>((sx - x0[x]) * ONE);
+            }
+
+            const auto *src = static_cast<const uint8_t *>(frame.ptr);
+            const size_t src_stride = static_cast<size_t>(frame.width) * src_bpp;
+            for (int y = 0; y < scaled_h; ++y) {
+                const float sy = std::max((y + 0.5f) * frame.height / scaled_h - 0.5f, 0.0f);
+                const int y0 = std::min(static_cast<int>(sy), frame.height - 1);
+                const int y1 = std::min(y0 + 1, frame.height - 1);
+                const int fy = static_cast<int>((sy - y0) * ONE);
+                const uint8_t *r0 = src + y0 * src_stride;
+                const uint8_t *r1 = src + y1 * src_stride;
+
+                uint8_t *out = dst + (meta.pad_y + y) * row_bytes();
+                std::memset(out, config_.pad_value, meta.pad_x * dst_bpp);
+                std::memset(out + (meta.pad_x + scaled_w) * dst_bpp, config_.pad_value,
+                            (config_.width - meta.pad_x - scaled_w) * dst_bpp);
+                out += meta.pad_x * dst_bpp;
+                for (int x = 0; x < scaled_w; ++x) {
+                    const int a = x0[x] * src_bpp;
+                    const int b = std::min(x0[x] + 1, frame.width - 1) * src_bpp;
+                    for (int c = 0; c < 3; ++c) {
+                        const int s = src_order[c];
+                        const int top = r0[a + s] * (ONE - fx[x]) + r0[b + s] * fx[x];
+                        const int bottom = r1[a + s] * (ONE - fx[x]) + r1[b + s] * fx[x];
+                        const int v = (top * (ONE - fy) + bottom * fy + (1 << (2 * SHIFT - 1))) >> (2 * SHIFT);
+                        out[dst_order[c]] = static_cast<uint8_t>(v);
+                    }
+                    if (dst_bpp == 4) out[3] = 255;
+                    out += dst_bpp;
+                }
+            }
+        }
+
+        [[nodiscard]] int scaled_width(const BatchSlot &meta) const {
+            return std::max(std::min(static_cast<int>(meta.src_width * meta.scale + 0.5f), config_.width), 1);
+        }
+
+        [[nodiscard]] int scaled_height(const BatchSlot &meta) const {
+            return std::max(std::min(static_cast<int>(meta.src_height * meta.scale + 0.5f), config_.height), 1);
+        }
+
+        /*
+         * RGA 直接缩放到槽位内有效区域：要求左右不留边（横屏源进方形张量的常见情况），目标行宽 64 字节对齐，
+         * 上下边框由 CPU 填充并在 RGA 写入前刷出缓存。不满足条件或 RGA 失败返回 false。
+         */
+        bool letterbox_rga(const FrameX &frame, const BatchSlot &meta, uint8_t *dst, const PoolBuffer &buffer) const {
+#if VCODECX_HAS_DMA
+            if (!rga_applicable(frame, meta)) return false;
+            const RgaSURF_FORMAT src_fmt = image_format_to_rgafmt(frame.format);
+
+            const int scaled_h = scaled_height(meta);
+            fill_rows(dst, 0, meta.pad_y);
+            fill_rows(dst, meta.pad_y + scaled_h, config_.height);
+            buffer.sync_cpu_to_device();
+
+            uint8_t *out = dst + meta.pad_y * row_bytes();
+            const RgaSURF_FORMAT dst_fmt = image_format_to_rgafmt(config_.format);
+            if (frame.fd >= 0) {
+                return rga_->transform(frame.fd, frame.width, frame.height, src_fmt,
+                                       out, config_.width, scaled_h, dst_fmt);
+            }
+            return rga_->transform(frame.ptr, frame.width, frame.height, src_fmt,
+                                   out, config_.width, scaled_h, dst_fmt);
+#else
+            (void) frame;
+            (void) meta;
+            (void) dst;
+            (void) buffer;
+            return false;
+#endif
+        }
+
+    private:
+        std::shared_ptr<Manager> manager_;
+        std::vector<std::string> stream_ids_;
+        BatchConfig config_;
+        Callback callback_;
+        std::shared_ptr<FramePool> pool_;
+        size_t slot_size_{0};
+#if VCODECX_HAS_DMA
+        std::shared_ptr<rockchip::RgaX> rga_;
+#endif
+
+        std::mutex state_mutex_;
+        std::vector<std::pair<std::string, int> > subscriptions_;
+        std::thread flusher_;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool running_{false};
+        std::shared_ptr<PoolBuffer> current_;
+        std::vector<BatchSlot> slots_;
+        std::chrono::steady_clock::time_point first_{};
+        int writers_{0};
+
+        std::atomic<uint64_t> num_batches_{0};
+        std::atomic<uint64_t> num_dropped_{0};
+        std::atomic<uint64_t> num_replaced_{0};
+    };
+}
@@ -2,6 +2,7 @@
 
 #include <future>
 
+#include "vcodecx/stats.h"
 #include "vcodecx/types.h"
 
 namespace vcodecx {
@@ -35,6 +36,15 @@ namespace vcodecx {
 
         [[nodiscard]] virtual DecodeConfig decode_config() const = 0;
 
+        /// 运行统计快照；后端不提供统计时只有 id 和 state
+        CodecStats stats() {
+            if (auto *provider = dynamic_cast<StatsProvider *>(this)) return provider->collect_stats();
+            CodecStats stats;
+            stats.id = id();
+            stats.state = state();
+            return stats;
+        }
+
         [[nodiscard]] bool is_released() const noexcept {
             return released_.load(std::memory_order_acquire);
         }
@@ -77,6 +87,15 @@ namespace vcodecx {
 
         [[nodiscard]] virtual EncodeConfig encode_config() const = 0;
 
+        /// 运行统计快照；后端不提供统计时只有 id 和 state
+        CodecStats stats() {
+            if (auto *provider = dynamic_cast<StatsProvider *>(this)) return provider->collect_stats();
+            CodecStats stats;
+            stats.id = id();
+            stats.state = state();
+            return stats;
+        }
+
         [[nodiscard]] bool is_released() const noexcept {
             return released_.load(std::memory_order_acquire);
         }
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <climits>
+#include <cstdint>
+#include <algorithm>
+
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace vcodecx {
+    /*
+     * 只保留最新一项的邮箱：无锁三缓冲，生产者永远不阻塞，未读的旧项直接被覆盖释放，读到的总是最新一项。
+     * 读端没有新项时在 futex 上等待，生产者只在有人等待时才做唤醒的系统调用。
+     * 单生产者、单消费者；close() 不能与 push() 并发（生产者停止后调用）。
+     * rkmpp 后端可在 Callback 模式的回调里 push()，读线程 pop()，得到同样的“只要最新帧”语义。
+     */
+    template<typename T>
+    class LatestMailbox {
+    public:
+        LatestMailbox() = default;
+
+        LatestMailbox(const LatestMailbox &) = delete;
+
+        LatestMailbox &operator=(const LatestMailbox &) = delete;
+
+        /// 放入新项，覆盖了未读的旧项时返回 true
+        bool push(std::shared_ptr<T> item) {
+            slots_[back_] = std::move(item);
+            const uint32_t prev = state_.exchange(back_ | FRESH);
+            back_ = prev & INDEX_MASK;
+            // 换回来的是被覆盖的未读项或读端已取空的槽，在生产者这边释放，不拖住缓冲池
+            slots_[back_].reset();
+            seq_.fetch_add(1);
+            if (waiters_.load() > 0) futex(FUTEX_WAKE_PRIVATE, INT_MAX, nullptr);
+            const bool dropped = (prev & FRESH) != 0;
+            if (dropped) num_dropped_.fetch_add(1, std::memory_order_relaxed);
+            return dropped;
+        }
+
+        /// 取最新一项，最多等待 timeout_ms；超时或已关闭返回 false
+        bool pop(std::shared_ptr<T> &item, const int timeout_ms) {
+            using Clock = std::chrono::steady_clock;
+            const auto deadline = Clock::now() + std::chrono::milliseconds(std::max(timeout_ms, 0));
+            while (true) {
+                if ((state_.load() & FRESH) != 0) {
+                    front_ = state_.exchange(front_) & INDEX_MASK;
+                    item = std::move(slots_[front_]);
+                    return true;
+                }
+                if (closed_.load()) return false;
+
+                // 先取序号再复查，push 在两者之间发生时 futex 会因序号变化立即返回
+                const uint32_t seq = seq_.load();
+                if ((state_.load() & FRESH) != 0 || closed_.load()) continue;
+                const auto remaining = deadline - Clock::now();
+                if (remaining <= Clock::duration::zero()) return false;
+
+                const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+                timespec timeout{static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+                waiters_.fetch_add(1);
+                futex(FUTEX_WAIT_PRIVATE, seq, &timeout);
+                waiters_.fetch_sub(1);
+            }
+        }
+
+        /// 唤醒读端并释放未读项，之后 pop() 返回 false
+        void close() {
+            slots_[back_].reset();
+            back_ = state_.exchange(back_) & INDEX_MASK;
+            slots_[back_].reset();
+            closed_.store(true);
+            seq_.fetch_add(1);
+            futex(FUTEX_WAKE_PRIVATE, INT_MAX, nullptr);
+        }
+
+        /// 是否有未读项（0 或 1）
+        [[nodiscard]] int size() const { return (state_.load(std::memory_order_relaxed) & FRESH) != 0 ? 1 : 0; }
+
+        /// 未读就被覆盖的项数
+        [[nodiscard]] uint64_t num_dropped() const { return num_dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr uint32_t INDEX_MASK = 0x3;
+        static constexpr uint32_t FRESH = 0x4;
+
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+                      "futex needs a plain 32-bit atomic");
+
+        void futex(const int op, const uint32_t value, const timespec *timeout) {
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq_), op, value, timeout, nullptr, 0);
+        }
+
+    private:
+        std::shared_ptr<T> slots_[3];
+        // 低两位为中间槽下标，FRESH 表示中间槽有未读项；默认全用 seq_cst，与 futex 的序号检查配合
+        std::atomic<uint32_t> state_{1};
+        uint32_t back_{0}; // 仅生产者访问
+        uint32_t front_{2}; // 仅消费者访问
+        std::atomic<uint32_t> seq_{0};
+        std::atomic<int> waiters_{0};
+        std::atomic<bool> closed_{false};
+        std::atomic<uint64_t> num_dropped_{0};
+    };
+}
@@ -1,10 +1,24 @@
 #pragma once
 
+#include <algorithm>
 #include <unordered_map>
 
 #include "vcodecx/codec.h"
 
+// librkffmpeg（rkmpp 硬件编解码）只有 aarch64 版本
+#if defined(__aarch64__)
+#define VCODECX_HAS_RKMPP 1
+#else
+#define VCODECX_HAS_RKMPP 0
+#endif
+
 namespace vcodecx {
+    enum class Backend {
+        Default, // 环境变量 VCODECX_BACKEND=software 时用软件后端，否则有 rkmpp 用 rkmpp
+        Rkmpp, // librkffmpeg，RkFfmDecoderImpl / RkFfmEncoderImpl
+        Software // libavcodec + swscale，见 vcodecx/soft.h
+    };
+
     class Manager {
     public:
         virtual ~Manager() = default;
@@ -43,7 +57,41 @@ namespace vcodecx {
 
         virtual bool release_encoder(const std::string &key) = 0;
 
+        /// ---------------- 统计 ----------------
+        /// 所有编解码器的统计快照及合计，按 busy 从高到低排列
+        ManagerStats stats() {
+            ManagerStats total;
+            const auto add = [&total](const CodecStats &stats) {
+                total.busy += stats.busy;
+                total.queue_dropped += stats.queue_dropped;
+                total.reconnects += stats.reconnects;
+                if (stats.state == CodecState::Running) ++total.num_running;
+                if (stats.state == CodecState::Error) ++total.num_error;
+            };
+            for (auto &kv: get_all_decoders()) {
+                total.decoders.push_back(kv.second->stats());
+                total.decode_fps += total.decoders.back().output_fps;
+                total.input_bitrate_bps += total.decoders.back().input_bitrate_bps;
+                total.max_first_frame_ms = std::max(total.max_first_frame_ms, total.decoders.back().first_frame_ms);
+                add(total.decoders.back());
+            }
+            for (auto &kv: get_all_encoders()) {
+                total.encoders.push_back(kv.second->stats());
+                total.encode_fps += total.encoders.back().output_fps;
+                total.output_bitrate_bps += total.encoders.back().output_bitrate_bps;
+                add(total.encoders.back());
+            }
+            const auto by_busy = [](const CodecStats &a, const CodecStats &b) { return a.busy > b.busy; };
+            std::sort(total.decoders.begin(), total.decoders.end(), by_busy);
+            std::sort(total.encoders.begin(), total.encoders.end(), by_busy);
+            return total;
+        }
+
         /// ---------------- 初始化入口 ----------------
+        /// librkffmpeg 提供；没有它的平台（x86）上由 vcodecx/soft.h 定义为软件后端
         static std::shared_ptr<Manager> create();
+
+        /// 指定后端，不可用时返回 nullptr；定义在 vcodecx/soft.h，用到时包含它并链接 avformat/avcodec/swscale/avutil
+        static std::shared_ptr<Manager> create(Backend backend);
     };
 }
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <condition_variable>
+
+#include "vcodecx/types.h"
+
+// aarch64 上输出缓冲用 dma-heap 分配，fd 可直接交给 RGA / 编码器
+#if defined(__aarch64__) && __has_include("toolkitx/rockchip/allocatorx.h")
+#include "toolkitx/rockchip/allocatorx.h"
+#define VCODECX_HAS_DMA 1
+#else
+#define VCODECX_HAS_DMA 0
+#endif
+
+namespace vcodecx {
+    /// 池中的一块输出缓冲，紧凑排列的图像内存（无行对齐），fd 为 -1 表示普通堆内存
+    struct PoolBuffer {
+        void *ptr{nullptr};
+        int fd{-1};
+        size_t size{0};
+        uint64_t generation{0};
+        std::shared_ptr<void> memory{};
+#if VCODECX_HAS_DMA
+        rockchip::DmaBuffer *dma{nullptr};
+#endif
+
+        /// CPU 写完后刷缓存，设备（RGA/VPU）再读
+        void sync_cpu_to_device() const {
+#if VCODECX_HAS_DMA
+            if (dma != nullptr) (void) dma->sync_cpu_to_device();
+#endif
+        }
+
+        /// 设备（RGA/VPU）写完后使 CPU 缓存失效，CPU 再读
+        void sync_device_to_cpu() const {
+#if VCODECX_HAS_DMA
+            if (dma != nullptr) (void) dma->sync_device_to_cpu();
+#endif
+        }
+    };
+
+    /*
+     * 解码输出缓冲池：缓冲按需分配、最多 capacity 块，FrameX::holder 的最后一个引用释放时缓冲回到池中，
+     * 避免每帧分配/释放整幅图像带来的缺页和分配器开销。图像尺寸变化时旧缓冲在归还时直接释放。
+     * aarch64 上用 rockchip::DmaBuffer（带缓存的 dma-heap，fd 可用于零拷贝），分配失败或 x86 上退回堆内存。
+     * 池对象本身由 shared_ptr 管理，缓冲可以比池活得更久。线程安全。
+     */
+    class FramePool : public std::enable_shared_from_this<FramePool> {
+    public:
+        FramePool(const int capacity, const PoolExhaust exhaust)
+                : capacity_(std::max(capacity, 1)), exhaust_(exhaust) {}
+
+        FramePool(const FramePool &) = delete;
+
+        FramePool &operator=(const FramePool &) = delete;
+
+        /// 按解码选项创建，pool_size 为负数时返回空（不使用池）
+        static std::shared_ptr<FramePool> create(const SwDecodeOptions &options, const int max_queue_size) {
+            if (options.pool_size < 0) return nullptr;
+            const int capacity = options.pool_size > 0 ? options.pool_size : std::max(max_queue_size, 1) + 3;
+            return std::make_shared<FramePool>(capacity, options.pool_exhaust);
+        }
+
+        /// 取一块 size 字节的缓冲；池空时按 PoolExhaust 处理，Wait 最多等 timeout_ms，取不到返回空
+        std::shared_ptr<PoolBuffer> acquire(const size_t size, const int timeout_ms) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (size != buffer_size_) {
+                // 尺寸变化：丢弃空闲缓冲，在外的旧缓冲归还时释放
+                free_.clear();
+                buffer_size_ = size;
+                allocated_ = 0;
+                ++generation_;
+            }
+
+            if (free_.empty() && allocated_ >= capacity_) {
+                num_exhausted_.fetch_add(1, std::memory_order_relaxed);
+                if (exhaust_ == PoolExhaust::Drop) return nullptr;
+                if (exhaust_ == PoolExhaust::Grow) {
+                    lock.unlock();
+                    auto buffer = allocate(size, 0);
+                    if (!buffer) return nullptr;
+                    return {buffer.release(), [](PoolBuffer *p) { delete p; }};
+                }
+                const uint64_t generation = generation_;
+                if (!cv_.wait_for(lock, std::chrono::milliseconds(std::max(timeout_ms, 0)), [&] {
+                    return !free_.empty() || generation != generation_ || closed_;
+                }) || closed_ || generation != generation_) {
+                    return nullptr;
+                }
+            }
+
+            std::unique_ptr<PoolBuffer> buffer;
+            if (!free_.empty()) {
+                buffer = std::move(free_.back());
+                free_.pop_back();
+            } else {
+                ++allocated_;
+                const uint64_t generation = generation_;
+                lock.unlock();
+                buffer = allocate(size, generation);
+                lock.lock();
+                if (!buffer) {
+                    if (generation == generation_) --allocated_;
+                    return nullptr;
+                }
+            }
+            lock.unlock();
+
+            std::weak_ptr<FramePool> weak = weak_from_this();
+            return {buffer.release(), [weak](PoolBuffer *p) {
+                if (auto pool = weak.lock()) {
+                    pool->recycle(p);
+                } else {
+                    delete p;
+                }
+            }};
+        }
+
+        /// 唤醒等待中的 acquire，之后归还的缓冲直接释放
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+                free_.clear();
+            }
+            cv_.notify_all();
+        }
+
+        [[nodiscard]] int capacity() const { return capacity_; }
+
+        /// 当前尺寸下已分配（含在外）的池内缓冲数
+        [[nodiscard]] int allocated() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return allocated_;
+        }
+
+        [[nodiscard]] size_t available() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return free_.size();
+        }
+
+        /// 池空的次数，持续增长说明下游持有帧太久或 pool_size 偏小
+        [[nodiscard]] uint64_t num_exhausted() const { return num_exhausted_.load(std::memory_order_relaxed); }
+
+    private:
+        static std::unique_ptr<PoolBuffer> allocate(const size_t size, const uint64_t generation) {
+            auto buffer = std::make_unique<PoolBuffer>();
+            buffer->size = size;
+            buffer->generation = generation;
+#if VCODECX_HAS_DMA
+            auto dma = std::make_shared<rockchip::DmaBuffer>();
+            if (dma->alloc(size, DMA_HEAP_PATH) && !dma->empty()) {
+                buffer->ptr = dma->ptr();
+                buffer->fd = dma->fd();
+                buffer->dma = dma.get();
+                buffer->memory = std::move(dma);
+                return buffer;
+            }
+#endif
+            // 64 字节对齐，满足 swscale 的 SIMD 写入
+            void *ptr = ::operator new(size, std::align_val_t(64), std::nothrow);
+            if (ptr == nullptr) return nullptr;
+            buffer->ptr = ptr;
+            buffer->memory = std::shared_ptr<void>(ptr, [](void *p) { ::operator delete(p, std::align_val_t(64)); });
+            return buffer;
+        }
+
+        void recycle(PoolBuffer *buffer) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!closed_ && buffer->generation == generation_) {
+                    free_.emplace_back(buffer);
+                    buffer = nullptr;
+                }
+            }
+            if (buffer == nullptr) {
+                cv_.notify_one();
+            } else {
+                delete buffer;
+            }
+        }
+
+    private:
+        const int capacity_;
+        const PoolExhaust exhaust_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<std::unique_ptr<PoolBuffer> > free_;
+        size_t buffer_size_{0};
+        int allocated_{0};
+        uint64_t generation_{0};
+        bool closed_{false};
+        std::atomic<uint64_t> num_exhausted_{0};
+    };
+}
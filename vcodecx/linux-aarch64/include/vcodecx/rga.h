@@ -0,0 +1,37 @@
+#pragma once
+
+#include "vcodecx/pool.h"
+
+// aarch64 上用 RGA 做缩放/格式转换，条件同 VCODECX_HAS_DMA
+#if VCODECX_HAS_DMA
+#include "toolkitx/rockchip/rgax.h"
+
+namespace vcodecx {
+    /// ImageFormat 对应的 RGA 格式，不支持时为 RK_FORMAT_UNKNOWN
+    static inline RgaSURF_FORMAT image_format_to_rgafmt(const ImageFormat fmt) {
+        switch (fmt) {
+            case ImageFormat::RGB24:
+                return RK_FORMAT_RGB_888;
+            case ImageFormat::BGR24:
+                return RK_FORMAT_BGR_888;
+            case ImageFormat::RGBA32:
+                return RK_FORMAT_RGBA_8888;
+            case ImageFormat::BGRA32:
+                return RK_FORMAT_BGRA_8888;
+            case ImageFormat::NV12:
+                return RK_FORMAT_YCbCr_420_SP;
+            case ImageFormat::NV21:
+                return RK_FORMAT_YCrCb_420_SP;
+            case ImageFormat::I420:
+                return RK_FORMAT_YCbCr_420_P;
+            case ImageFormat::YV12:
+                return RK_FORMAT_YCrCb_420_P;
+            case ImageFormat::YUYV422:
+                return RK_FORMAT_YUYV_422;
+            case ImageFormat::UYVY422:
+                return RK_FORMAT_UYVY_422;
+        }
+        return RK_FORMAT_UNKNOWN;
+    }
+}
+#endif
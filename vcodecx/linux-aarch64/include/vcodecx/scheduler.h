@@ -0,0 +1,244 @@
+#pragma once
+
+#include <set>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace vcodecx {
+    enum class TaskState {
+        Ready, // 还有工作，重新排队
+        Wait, // 等待 wake() 或 wait_ms 超时
+        Done // 结束，从调度器移除
+    };
+
+    struct TaskStep {
+        TaskState state{TaskState::Ready};
+        int wait_ms{-1}; // Wait 时的超时，负数表示只等 wake()
+    };
+
+    /// 调度单元：每次 step() 只做一小段工作（如读一个包、解码、转换），不能长时间阻塞
+    class SchedTask {
+    public:
+        virtual ~SchedTask() = default;
+
+        virtual TaskStep step() = 0;
+    };
+
+    /*
+     * 固定数量、按核绑定的工作线程池，多路解码作为任务在其上轮转，代替每路一个线程。
+     * 按 stride 调度公平分配 step 次数：priority 每加 1 份额翻倍（-3..3），等待后重新就绪的任务不会补偿之前的份额。
+     * 同一任务同一时刻只在一个线程上运行。线程安全。
+     * 调度状态放在工作线程共同持有的 Core 里：任务的 step 放掉最后一个引用、析构发生在工作线程上时，
+     * 该线程分离后只会再碰 Core，不会访问已释放的 Scheduler。
+     */
+    class Scheduler {
+    public:
+        /// num_workers <= 0 时取 CPU 核数
+        explicit Scheduler(const int num_workers = 0, const bool pin_cores = true) : core_(std::make_shared<Core>()) {
+            const int cores = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+            const int count = num_workers > 0 ? num_workers : cores;
+            for (int i = 0; i < count; ++i) {
+                workers_.emplace_back([core = core_] { core->run(); });
+                if (!pin_cores) continue;
+                cpu_set_t cpus;
+                CPU_ZERO(&cpus);
+                CPU_SET(i % cores, &cpus);
+                pthread_setaffinity_np(workers_.back().native_handle(), sizeof(cpus), &cpus);
+            }
+        }
+
+        ~Scheduler() {
+            {
+                std::lock_guard<std::mutex> lock(core_->mutex);
+                core_->stopping = true;
+            }
+            core_->cv.notify_all();
+            for (auto &worker: workers_) {
+                if (worker.get_id() == std::this_thread::get_id()) {
+                    worker.detach(); // 本线程持有 Core，step 返回后看到 stopping 即退出
+                } else if (worker.joinable()) {
+                    worker.join();
+                }
+            }
+        }
+
+        Scheduler(const Scheduler &) = delete;
+
+        Scheduler &operator=(const Scheduler &) = delete;
+
+        /// 添加任务并立即就绪，返回任务 id
+        int add(std::shared_ptr<SchedTask> task, const int priority = 0) {
+            Core &c = *core_;
+            std::lock_guard<std::mutex> lock(c.mutex);
+            const int id = ++c.last_id;
+            Entry &entry = c.tasks[id];
+            entry.task = std::move(task);
+            entry.stride = STRIDE_BASE >> (std::min(std::max(priority, -3), 3) + 3);
+            c.make_ready(id, entry);
+            c.cv.notify_one();
+            return id;
+        }
+
+        /// 唤醒等待中的任务（如 I/O 就绪），运行中的任务在本次 step 结束后重新排队
+        void wake(const int id) {
+            Core &c = *core_;
+            std::lock_guard<std::mutex> lock(c.mutex);
+            const auto it = c.tasks.find(id);
+            if (it == c.tasks.end()) return;
+            Entry &entry = it->second;
+            if (entry.running) {
+                entry.woken = true;
+            } else if (entry.waiting) {
+                c.timers.erase({entry.deadline, id});
+                c.make_ready(id, entry);
+                c.cv.notify_one();
+            }
+        }
+
+        /*
+         * 移除任务，其他线程上正在运行的 step 会先等它结束；返回后任务不会再被调用。
+         * 在该任务自己的 step 里调用时无法等待，返回 false，任务在本次 step 结束后移除。
+         */
+        bool remove(const int id) {
+            Core &c = *core_;
+            std::unique_lock<std::mutex> lock(c.mutex);
+            auto it = c.tasks.find(id);
+            if (it == c.tasks.end()) return true;
+            if (it->second.running && it->second.runner == std::this_thread::get_id()) {
+                it->second.removed = true;
+                return false;
+            }
+            it->second.removed = true;
+            c.idle_cv.wait(lock, [&] { return !c.tasks.count(id) || !c.tasks[id].running; });
+            it = c.tasks.find(id);
+            if (it == c.tasks.end()) return true;
+            const std::shared_ptr<SchedTask> task = std::move(it->second.task);
+            c.erase(it);
+            lock.unlock(); // 任务在锁外析构
+            return true;
+        }
+
+        [[nodiscard]] int num_workers() const { return static_cast<int>(workers_.size()); }
+
+        [[nodiscard]] size_t num_tasks() const {
+            std::lock_guard<std::mutex> lock(core_->mutex);
+            return core_->tasks.size();
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry {
+            std::shared_ptr<SchedTask> task;
+            uint64_t stride{0};
+            uint64_t pass{0};
+            bool running{false};
+            bool waiting{false};
+            bool woken{false};
+            bool removed{false};
+            std::thread::id runner{};
+            Clock::time_point deadline{};
+        };
+
+        static constexpr uint64_t STRIDE_BASE = 1u << 20;
+
+        struct Core {
+            std::mutex mutex;
+            std::condition_variable cv;
+            std::condition_variable idle_cv;
+            std::unordered_map<int, Entry> tasks;
+            std::set<std::pair<uint64_t, int> > ready;
+            std::set<std::pair<Clock::time_point, int> > timers;
+            uint64_t virtual_time{0};
+            int last_id{0};
+            bool stopping{false};
+
+            void make_ready(const int id, Entry &entry) {
+                // 不补偿等待期间少用的份额，否则久等的任务回来后会独占线程
+                entry.pass = std::max(entry.pass, virtual_time);
+                entry.waiting = false;
+                ready.emplace(entry.pass, id);
+            }
+
+            void erase(std::unordered_map<int, Entry>::iterator it) {
+                if (it->second.waiting) timers.erase({it->second.deadline, it->first});
+                ready.erase({it->second.pass, it->first});
+                tasks.erase(it);
+            }
+
+            void run() {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (!stopping) {
+                    const auto now = Clock::now();
+                    while (!timers.empty() && timers.begin()->first <= now) {
+                        const int id = timers.begin()->second;
+                        timers.erase(timers.begin());
+                        make_ready(id, tasks[id]);
+                    }
+                    if (ready.empty()) {
+                        if (timers.empty()) {
+                            cv.wait(lock);
+                        } else {
+                            // 拷贝一份，等待期间这个定时器可能被其他线程删掉
+                            const Clock::time_point deadline = timers.begin()->first;
+                            cv.wait_until(lock, deadline);
+                        }
+                        continue;
+                    }
+
+                    const auto [pass, id] = *ready.begin();
+                    ready.erase(ready.begin());
+                    virtual_time = std::max(virtual_time, pass);
+                    std::shared_ptr<SchedTask> task = tasks[id].task;
+                    tasks[id].running = true;
+                    tasks[id].runner = std::this_thread::get_id();
+                    // 还有就绪任务时叫醒另一个线程
+                    if (!ready.empty()) cv.notify_one();
+
+                    lock.unlock();
+                    const TaskStep step = task->step();
+                    task.reset();
+                    lock.lock();
+
+                    auto it = tasks.find(id);
+                    if (it == tasks.end()) continue;
+                    Entry &entry = it->second;
+                    entry.running = false;
+                    entry.pass += entry.stride;
+                    if (entry.removed || step.state == TaskState::Done) {
+                        // 任务可能持有最后一个引用，析构时会回调 remove()，放到锁外
+                        task = std::move(entry.task);
+                        tasks.erase(it);
+                        idle_cv.notify_all();
+                        lock.unlock();
+                        task.reset();
+                        lock.lock();
+                        continue;
+                    }
+                    if (step.state == TaskState::Ready || entry.woken) {
+                        entry.woken = false;
+                        make_ready(id, entry);
+                    } else {
+                        entry.waiting = true;
+                        entry.deadline = step.wait_ms < 0 ? Clock::time_point::max()
+                                                          : Clock::now() + std::chrono::milliseconds(step.wait_ms);
+                        if (step.wait_ms >= 0) timers.emplace(entry.deadline, id);
+                    }
+                }
+            }
+        };
+
+    private:
+        std::shared_ptr<Core> core_;
+        std::vector<std::thread> workers_;
+    };
+}
@@ -10,8 +10,26 @@ namespace vcodecx {
         QueueRead // 队列轮询读取模式（消费者主动从队列取）
     };
 
+    enum class QueuePolicy {
+        Fifo, // 有界先进先出，满时丢最旧（录像等需要连续帧的场景）
+        Latest // 只保留最新一帧，无锁三缓冲 + futex 等待（分析/推理只要最新帧）
+    };
+
     enum class MediaType { File, Camera, RTSP };
 
+    /// 省下的解码量随码流结构而定（IPPP 摄像头流几乎没有非参考帧），以 stats() 的 busy 与 discarded 实测为准
+    enum class Decimate {
+        None, // 全部解码，只按 max_fps 丢弃输出
+        NonRef, // 解码前丢弃非参考帧（包级识别 + AVDISCARD_NONREF），不影响其余帧
+        KeyOnly // 只解码关键帧，适合只要抽帧的分析
+    };
+
+    enum class PoolExhaust {
+        Grow, // 池已空时临时分配一块池外缓冲，用完即释放
+        Wait, // 等待下游归还缓冲（解码线程阻塞）
+        Drop // 丢弃当前帧
+    };
+
     enum class CodecType { H264, H265, HEVC };
 
     enum class ImageFormat {
@@ -140,6 +158,25 @@ namespace vcodecx {
         }
     };
 
+    /*
+     * 软件后端（vcodecx/soft.h）才有的解码选项。DecodeConfig / EncodeConfig 与预编译的 librkffmpeg 共用，
+     * 布局不能改，新选项都放在这里，通过 SwFfmManagerImpl::create_decoder 的重载传入，rkmpp 后端不支持。
+     */
+    struct SwDecodeOptions {
+        int pool_size{0}; // 输出缓冲池大小，0 为 max_queue_size + 3，负数不使用池（每帧分配）
+        PoolExhaust pool_exhaust{PoolExhaust::Grow}; // 池中缓冲全部被下游持有时的行为
+        int priority{0}; // 共享工作线程池上的调度优先级，每加 1 份额翻倍（-3..3）
+        Decimate decimate{Decimate::None}; // 解码前的降帧方式
+        bool fast_start{false}; // 最小探测打开，按 uri 缓存编码参数，重连时跳过完整探测
+        int reconnect_max_ms{0}; // 实时流断线后自动重连的最大退避（毫秒），0 不重连
+        QueuePolicy queue_policy{QueuePolicy::Fifo}; // QueueRead 模式下输出队列的策略
+    };
+
+    /// 软件后端才有的编码选项，见 SwDecodeOptions
+    struct SwEncodeOptions {
+        int bitrate_kbps{0}; // 目标码率（kbps），0 为编码器默认
+    };
+
     // ===========================================================
     //                      枚举类型转换
     // ===========================================================
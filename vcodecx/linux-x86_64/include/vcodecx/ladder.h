@@ -0,0 +1,274 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "vcodecx/rga.h"
+#include "vcodecx/soft.h"
+
+namespace vcodecx {
+    /*
+     * 编码阶梯：一路输入帧同时编成多个分辨率/码率（如主码流 1080p + 子码流 360p），每档一个 EncodeConfig。
+     * 每档是 Manager 创建的普通 Encoder，各自的编码会话/线程并行工作，write() 只负责把帧分发到各档：
+     * 尺寸与输入相同的档直接复用输入 FrameX；其余档在 aarch64 上由 RGA 从输入的 dma fd 缩放到该档的
+     * dma 缓冲池，编码器按 fd 取用，不经 CPU 拷贝；RGA 不可用或行宽不满足 64 字节对齐时退回 swscale
+     * （需要软件后端的头文件）。缩放后的帧格式与输入相同。
+     * 每档按自己的 max_fps 限帧；输出通过 subscribe(index, cb) 或 encoder(index) 按档订阅。
+     * options 给出各档的软件后端选项（如码率），只在 manager 为 SwFfmManagerImpl 时生效。
+     * write() 需由同一线程调用，其余接口线程安全。
+     */
+    class EncoderLadder {
+    public:
+        EncoderLadder(std::shared_ptr<Manager> manager, const std::vector<EncodeConfig> &renditions,
+                      const std::vector<SwEncodeOptions> &options = {})
+                : manager_(std::move(manager)) {
+#if VCODECX_HAS_DMA
+            rga_ = rockchip::RgaX::instance();
+#endif
+            for (size_t i = 0; i < renditions.size(); ++i) {
+                const EncodeConfig &config = renditions[i];
+                auto rung = std::make_unique<Rung>();
+                rung->config = config;
+                if (i < options.size()) rung->options = options[i];
+                // 池空说明该档编码跟不上，丢帧而不是阻塞其他档
+                rung->pool = std::make_shared<FramePool>(std::max(config.max_queue_size, 1) + 2, PoolExhaust::Drop);
+                rungs_.push_back(std::move(rung));
+            }
+        }
+
+        ~EncoderLadder() {
+            release();
+#if VCODECX_HAS_SOFTWARE
+            for (auto &rung: rungs_) sws_freeContext(rung->sws);
+#endif
+        }
+
+        EncoderLadder(const EncoderLadder &) = delete;
+
+        EncoderLadder &operator=(const EncoderLadder &) = delete;
+
+        /// 创建并打开各档编码器，任一档失败时全部释放并返回 false
+        bool open() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (opened_) return true;
+            if (!manager_ || rungs_.empty()) return false;
+            for (auto &rung: rungs_) {
+                rung->encoder = create_encoder(*rung);
+                if (!rung->encoder || !rung->encoder->open()) {
+                    release_encoders();
+                    return false;
+                }
+            }
+            opened_ = true;
+            return true;
+        }
+
+        /// 把一帧分发到各档，每档的写入最多等待 timeout_ms；到期的档都写入成功时返回 true
+        bool write(const std::shared_ptr<FrameX> &frame, const int timeout_ms) {
+            if (!frame || frame->ptr == nullptr || !opened_.load()) return false;
+            bool ok = true;
+            const auto now = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < rungs_.size(); ++i) {
+                Rung &rung = *rungs_[i];
+                const auto encoder = this->encoder(i); // 与 release() 并发时拿到空或仍有效的编码器
+                if (!encoder) return false;
+                if (skip_frame(rung, now)) continue;
+
+                std::shared_ptr<FrameX> item = frame;
+                if (rung.config.width != frame->width || rung.config.height != frame->height) {
+                    item = scale(rung, *frame);
+                }
+                if (!item || !encoder->write(item, timeout_ms)) {
+                    rung.num_dropped.fetch_add(1, std::memory_order_relaxed);
+                    ok = false;
+                }
+            }
+            return ok;
+        }
+
+        /// 订阅第 index 档的编码输出，index 越界返回 -1
+        int subscribe(const size_t index, Encoder::Callback cb) {
+            const auto encoder = this->encoder(index);
+            return encoder ? encoder->subscribe(std::move(cb)) : -1;
+        }
+
+        void unsubscribe(const size_t index, const int id) {
+            if (const auto encoder = this->encoder(index)) encoder->unsubscribe(id);
+        }
+
+        /// 第 index 档的编码器，未打开或越界时为空
+        [[nodiscard]] std::shared_ptr<Encoder> encoder(const size_t index) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return index < rungs_.size() ? rungs_[index]->encoder : nullptr;
+        }
+
+        [[nodiscard]] size_t size() const { return rungs_.size(); }
+
+        /// 第 index 档因缩放失败、缓冲池空或写入超时丢弃的帧数
+        [[nodiscard]] uint64_t num_dropped(const size_t index) const {
+            return index < rungs_.size() ? rungs_[index]->num_dropped.load(std::memory_order_relaxed) : 0;
+        }
+
+        /// 释放各档编码器，可重复调用
+        void release() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            release_encoders();
+        }
+
+        static std::shared_ptr<EncoderLadder> create(std::shared_ptr<Manager> manager,
+                                                     const std::vector<EncodeConfig> &renditions,
+                                                     const std::vector<SwEncodeOptions> &options = {}) {
+            auto ladder = std::make_shared<EncoderLadder>(std::move(manager), renditions, options);
+            return ladder->open() ? ladder : nullptr;
+        }
+
+    private:
+        struct Rung {
+            EncodeConfig config{};
+            SwEncodeOptions options{};
+            std::shared_ptr<Encoder> encoder;
+            std::shared_ptr<FramePool> pool;
+            std::chrono::steady_clock::time_point last_write{};
+            std::atomic<uint64_t> num_dropped{0};
+#if VCODECX_HAS_SOFTWARE
+            SwsContext *sws{nullptr};
+#endif
+        };
+
+        /// 紧凑排列的图像字节数，不支持的格式为 0
+        static size_t image_bytes(const ImageFormat fmt, const int w, const int h) {
+            const size_t pixels = static_cast<size_t>(w) * h;
+            switch (fmt) {
+                case ImageFormat::RGB24:
+                case ImageFormat::BGR24:
+                    return pixels * 3;
+                case ImageFormat::RGBA32:
+                case ImageFormat::BGRA32:
+                    return pixels * 4;
+                case ImageFormat::NV12:
+                case ImageFormat::NV21:
+                case ImageFormat::I420:
+                case ImageFormat::YV12:
+                    return (w % 2 != 0 || h % 2 != 0) ? 0 : pixels * 3 / 2;
+                case ImageFormat::YUYV422:
+                case ImageFormat::UYVY422:
+                    return w % 2 != 0 ? 0 : pixels * 2;
+            }
+            return 0;
+        }
+
+        /// 按该档 max_fps 限帧，与解码器一致留 10% 余量
+        static bool skip_frame(Rung &rung, const std::chrono::steady_clock::time_point now) {
+            if (rung.config.max_fps <= 0) return false;
+            const auto interval = std::chrono::microseconds(900000 / rung.config.max_fps);
+            if (rung.last_write.time_since_epoch().count() != 0 && now - rung.last_write < interval) return true;
+            rung.last_write = now;
+            return false;
+        }
+
+        std::shared_ptr<FrameX> scale(Rung &rung, const FrameX &frame) {
+            const int w = rung.config.width;
+            const int h = rung.config.height;
+            const size_t size = image_bytes(frame.format, w, h);
+            if (size == 0) return nullptr;
+            const std::shared_ptr<PoolBuffer> buffer = rung.pool->acquire(size, 0);
+            if (!buffer) return nullptr;
+            if (!scale_rga(frame, *buffer, w, h) && !scale_cpu(rung, frame, *buffer, w, h)) return nullptr;
+            return std::make_shared<FrameX>(
+                    frame.stream_id, w, h, frame.format, buffer->fd, buffer->ptr, frame.pts, frame.timestamp, buffer
+            );
+        }
+
+        /// RGA 缩放，源和目标行宽都需 64 字节对齐；输入有 fd 时按 fd 读取
+        bool scale_rga(const FrameX &frame, const PoolBuffer &buffer, const int w, const int h) const {
+#if VCODECX_HAS_DMA
+            const RgaSURF_FORMAT fmt = image_format_to_rgafmt(frame.format);
+            if (!rga_ || fmt == RK_FORMAT_UNKNOWN) return false;
+            const int bytes = std::max(rockchip::get_bits_per_pixel(fmt) / 8, 1); // YUV 按亮度平面算
+            if (!rockchip::is_aligned(frame.width, bytes, 64) || !rockchip::is_aligned(w, bytes, 64)) return false;
+
+            bool ok;
+            if (frame.fd >= 0 && buffer.fd >= 0) {
+                ok = rga_->transform(frame.fd, frame.width, frame.height, fmt, buffer.fd, w, h, fmt);
+            } else if (frame.fd >= 0) {
+                ok = rga_->transform(frame.fd, frame.width, frame.height, fmt, buffer.ptr, w, h, fmt);
+            } else if (buffer.fd >= 0) {
+                ok = rga_->transform(frame.ptr, frame.width, frame.height, fmt, buffer.fd, w, h, fmt);
+            } else {
+                ok = rga_->transform(frame.ptr, frame.width, frame.height, fmt, buffer.ptr, w, h, fmt);
+            }
+            // 软件编码器会用 CPU 读取
+            if (ok) buffer.sync_device_to_cpu();
+            return ok;
+#else
+            (void) frame;
+            (void) buffer;
+            (void) w;
+            (void) h;
+            return false;
+#endif
+        }
+
+        static bool scale_cpu(Rung &rung, const FrameX &frame, const PoolBuffer &buffer, const int w, const int h) {
+#if VCODECX_HAS_SOFTWARE
+            uint8_t *src[4];
+            int src_linesize[4];
+            uint8_t *dst[4];
+            int dst_linesize[4];
+            const AVPixelFormat avfmt = image_format_to_avfmt(frame.format);
+            if (!fill_image_planes(static_cast<uint8_t *>(frame.ptr), frame.format, frame.width, frame.height,
+                                   src, src_linesize) ||
+                !fill_image_planes(static_cast<uint8_t *>(buffer.ptr), frame.format, w, h, dst, dst_linesize)) {
+                return false;
+            }
+            rung.sws = sws_getCachedContext(rung.sws, frame.width, frame.height, avfmt, w, h, avfmt, SWS_BILINEAR,
+                                            nullptr, nullptr, nullptr);
+            if (rung.sws == nullptr) return false;
+            sws_scale(rung.sws, src, src_linesize, 0, frame.height, dst, dst_linesize);
+            buffer.sync_cpu_to_device();
+            return true;
+#else
+            (void) rung;
+            (void) frame;
+            (void) buffer;
+            (void) w;
+            (void) h;
+            return false;
+#endif
+        }
+
+        std::shared_ptr<Encoder> create_encoder(const Rung &rung) {
+#if VCODECX_HAS_SOFTWARE
+            if (auto *software = dynamic_cast<SwFfmManagerImpl *>(manager_.get())) {
+                return software->create_encoder(rung.config, rung.options);
+            }
+#endif
+            return manager_->create_encoder(rung.config);
+        }
+
+        /// 调用时持有 mutex_
+        void release_encoders() {
+            opened_ = false;
+            for (auto &rung: rungs_) {
+                if (!rung->encoder) continue;
+                if (!manager_->release_encoder(rung->encoder->id())) rung->encoder->release();
+                rung->encoder.reset();
+            }
+        }
+
+    private:
+        std::shared_ptr<Manager> manager_;
+        std::vector<std::unique_ptr<Rung> > rungs_;
+#if VCODECX_HAS_DMA
+        std::shared_ptr<rockchip::RgaX> rga_;
+#endif
+
+        mutable std::mutex mutex_;
+        std::atomic<bool> opened_{false};
+    };
+}
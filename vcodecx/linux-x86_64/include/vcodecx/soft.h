@@ -0,0 +1,1250 @@
+#pragma once
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <condition_variable>
+
+#include "vcodecx/pool.h"
+#include "vcodecx/mailbox.h"
+#include "vcodecx/stats.h"
+#include "vcodecx/scheduler.h"
+#include "vcodecx/manager.h"
+
+#if __has_include(<libavcodec/avcodec.h>) && __has_include(<libavformat/avformat.h>) && \
+    __has_include(<libswscale/swscale.h>)
+#define VCODECX_HAS_SOFTWARE 1
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
+}
+#else
+#define VCODECX_HAS_SOFTWARE 0
+#endif
+
+namespace vcodecx {
+#if VCODECX_HAS_SOFTWARE
+    /// ImageFormat 对应的 AVPixelFormat（YV12 用 YUV420P 交换 U/V 平面），对应 rkmpp 后端的 avfmt_to_rgafmt
+    static inline AVPixelFormat image_format_to_avfmt(const ImageFormat fmt) {
+        switch (fmt) {
+            case ImageFormat::RGB24:
+                return AV_PIX_FMT_RGB24;
+            case ImageFormat::BGR24:
+                return AV_PIX_FMT_BGR24;
+            case ImageFormat::RGBA32:
+                return AV_PIX_FMT_RGBA;
+            case ImageFormat::BGRA32:
+                return AV_PIX_FMT_BGRA;
+            case ImageFormat::NV12:
+                return AV_PIX_FMT_NV12;
+            case ImageFormat::NV21:
+                return AV_PIX_FMT_NV21;
+            case ImageFormat::I420:
+            case ImageFormat::YV12:
+                return AV_PIX_FMT_YUV420P;
+            case ImageFormat::YUYV422:
+                return AV_PIX_FMT_YUYV422;
+            case ImageFormat::UYVY422:
+                return AV_PIX_FMT_UYVY422;
+        }
+        return AV_PIX_FMT_NONE;
+    }
+
+    /// 紧凑排列（无行对齐）的图像平面指针，与 FrameX::ptr 的内存布局一致
+    static inline bool fill_image_planes(
+            uint8_t *ptr, const ImageFormat fmt, const int w, const int h, uint8_t *data[4], int linesize[4]
+    ) {
+        const AVPixelFormat avfmt = image_format_to_avfmt(fmt);
+        if (avfmt == AV_PIX_FMT_NONE || av_image_fill_arrays(data, linesize, ptr, avfmt, w, h, 1) < 0) return false;
+        if (fmt == ImageFormat::YV12) std::swap(data[1], data[2]);
+        return true;
+    }
+
+    static inline size_t image_size(const ImageFormat fmt, const int w, const int h) {
+        const int size = av_image_get_buffer_size(image_format_to_avfmt(fmt), w, h, 1);
+        return size < 0 ? 0 : static_cast<size_t>(size);
+    }
+
+    /*
+     * 包里的 VCL NAL 是否全是非参考帧（H264 nal_ref_idc == 0，H265 子层非参考类型），丢掉不影响后续帧解码。
+     * 支持 Annex-B 和 4 字节长度前缀（mp4/mkv）两种封装；无法识别时返回 false。
+     */
+    static inline bool is_nonref_packet(const AVPacket *packet, const AVCodecID codec_id) {
+        if (codec_id != AV_CODEC_ID_H264 && codec_id != AV_CODEC_ID_HEVC) return false;
+        const uint8_t *p = packet->data;
+        const uint8_t *end = p + packet->size;
+        const bool annexb = packet->size >= 4 && p[0] == 0 && p[1] == 0 && (p[2] == 1 || (p[2] == 0 && p[3] == 1));
+
+        bool vcl = false;
+        while (p < end) {
+            const uint8_t *nal = nullptr;
+            const uint8_t *next = end;
+            if (annexb) {
+                while (p + 3 <= end && !(p[0] == 0 && p[1] == 0 && p[2] == 1)) ++p;
+                if (p + 3 > end) break;
+                nal = p + 3;
+                for (const uint8_t *q = nal; q + 3 <= end; ++q) {
+                    if (q[0] == 0 && q[1] == 0 && q[2] == 1) {
+                        next = q;
+                        break;
+                    }
+                }
+            } else {
+                if (end - p < 4) break;
+                const uint32_t length = static_cast<uint32_t>(p[0]) << 24 | p[1] << 16 | p[2] << 8 | p[3];
+                if (length == 0 || length > static_cast<uint32_t>(end - p - 4)) return false;
+                nal = p + 4;
+                next = nal + length;
+            }
+            p = next;
+            if (nal >= end) continue;
+
+            if (codec_id == AV_CODEC_ID_H264) {
+                const int type = nal[0] & 0x1F;
+                if (type < 1 || type > 5) continue;
+                if ((nal[0] & 0x60) != 0) return false;
+            } else {
+                const int type = (nal[0] >> 1) & 0x3F;
+                if (type >= 32) continue;
+                // TRAIL_N / TSA_N / STSA_N / RADL_N / RASL_N / RSV_VCL_N10..14
+                if (type > 14 || type % 2 != 0) return false;
+            }
+            vcl = true;
+        }
+        return vcl;
+    }
+
+    /*
+     * 按 uri 缓存探测到的视频参数（编码、分辨率、extradata），fast_start 重连时据此跳过 avformat_find_stream_info。
+     * 进程内共享，线程安全。
+     */
+    class CodecParamsCache {
+    public:
+        static CodecParamsCache &instance() {
+            static CodecParamsCache cache;
+            return cache;
+        }
+
+        void store(const std::string &uri, const AVCodecParameters *par) {
+            std::shared_ptr<AVCodecParameters> copy(avcodec_parameters_alloc(), [](AVCodecParameters *p) {
+                avcodec_parameters_free(&p);
+            });
+            if (!copy || avcodec_parameters_copy(copy.get(), par) < 0) return;
+            std::lock_guard<std::mutex> lock(mutex_);
+            params_[uri] = std::move(copy);
+        }
+
+        /// 用缓存补全同编码视频流缺的参数，没有缓存或编码不一致返回 false
+        bool apply(const std::string &uri, AVFormatContext *format) {
+            std::shared_ptr<AVCodecParameters> cached;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                const auto it = params_.find(uri);
+                if (it == params_.end()) return false;
+                cached = it->second;
+            }
+            for (unsigned i = 0; i < format->nb_streams; ++i) {
+                AVCodecParameters *par = format->streams[i]->codecpar;
+                if (par->codec_type != AVMEDIA_TYPE_VIDEO || par->codec_id != cached->codec_id) continue;
+                if (par->width == 0 || par->height == 0) {
+                    par->width = cached->width;
+                    par->height = cached->height;
+                    par->format = cached->format;
+                }
+                if (par->extradata_size == 0 && cached->extradata_size > 0) {
+                    par->extradata = static_cast<uint8_t *>(
+                            av_mallocz(cached->extradata_size + AV_INPUT_BUFFER_PADDING_SIZE));
+                    if (par->extradata == nullptr) return false;
+                    std::memcpy(par->extradata, cached->extradata, cached->extradata_size);
+                    par->extradata_size = cached->extradata_size;
+                }
+                return true;
+            }
+            return false;
+        }
+
+        void erase(const std::string &uri) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            params_.erase(uri);
+        }
+
+    private:
+        std::mutex mutex_;
+        std::map<std::string, std::shared_ptr<AVCodecParameters> > params_;
+    };
+
+    static inline uint32_t system_time_ms() {
+        using namespace std::chrono;
+        return static_cast<uint32_t>(duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count());
+    }
+
+    /*
+     * 输出分发：Callback 模式推给订阅者；QueueRead 模式进有界队列（满时丢最旧），
+     * QueuePolicy::Latest 时改用 LatestMailbox，只留最新一项（单读者）。回调耗时和丢弃计入 stats。
+     */
+    template<typename T>
+    class SwOutput {
+    public:
+        using Callback = std::function<void(const std::shared_ptr<T> &)>;
+
+        SwOutput(const WorkerMode mode, const int max_queue_size, StatsRecorder *stats = nullptr,
+                 const QueuePolicy policy = QueuePolicy::Fifo)
+                : mode_(mode), max_queue_size_(std::max(max_queue_size, 1)), stats_(stats),
+                  latest_(mode == WorkerMode::QueueRead && policy == QueuePolicy::Latest) {}
+
+        int subscribe(Callback cb) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const int id = ++last_id_;
+            subscribers_[id] = std::move(cb);
+            return id;
+        }
+
+        void unsubscribe(const int id) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            subscribers_.erase(id);
+        }
+
+        void publish(const std::shared_ptr<T> &item) {
+            if (mode_ == WorkerMode::Callback) {
+                std::map<int, Callback> subscribers;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    subscribers = subscribers_;
+                }
+                for (auto &kv: subscribers) {
+                    const auto start = StatsRecorder::Clock::now();
+                    kv.second(item);
+                    if (stats_ != nullptr) stats_->record_since(Stage::Callback, start);
+                }
+                return;
+            }
+            if (latest_) {
+                if (mailbox_.push(item) && stats_ != nullptr) stats_->add_queue_dropped();
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                while (queue_.size() >= static_cast<size_t>(max_queue_size_)) {
+                    queue_.pop_front();
+                    if (stats_ != nullptr) stats_->add_queue_dropped();
+                }
+                queue_.push_back(item);
+            }
+            cv_.notify_one();
+        }
+
+        bool read(std::shared_ptr<T> &item, const int timeout_ms) {
+            if (latest_) return mailbox_.pop(item, timeout_ms);
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!cv_.wait_for(lock, std::chrono::milliseconds(std::max(timeout_ms, 0)),
+                              [this] { return !queue_.empty() || closed_; }) || queue_.empty()) {
+                return false;
+            }
+            item = std::move(queue_.front());
+            queue_.pop_front();
+            return true;
+        }
+
+        [[nodiscard]] int size() const {
+            if (latest_) return mailbox_.size();
+            std::lock_guard<std::mutex> lock(mutex_);
+            return static_cast<int>(queue_.size());
+        }
+
+        [[nodiscard]] int capacity() const {
+            if (mode_ != WorkerMode::QueueRead) return 0;
+            return latest_ ? 1 : max_queue_size_;
+        }
+
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+                queue_.clear();
+                subscribers_.clear();
+            }
+            cv_.notify_all();
+            if (latest_) mailbox_.close();
+        }
+
+    private:
+        const WorkerMode mode_;
+        const int max_queue_size_;
+        StatsRecorder *stats_;
+        const bool latest_;
+        LatestMailbox<T> mailbox_;
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::deque<std::shared_ptr<T> > queue_;
+        std::map<int, Callback> subscribers_;
+        int last_id_{0};
+        bool closed_{false};
+    };
+
+    /*
+     * libavcodec 软解码器，接口和 FrameX 语义与 RkFfmDecoderImpl 一致，用于 x86 构建机上运行、压测流水线。
+     * 解码多线程（文件用帧+片级，实时流只用片级以免增加延迟），swscale 缩放并转换到 output_format，
+     * FrameX::ptr 为紧凑排列的图像，holder 持有内存；pts 为毫秒，timestamp 为系统时间（毫秒）。
+     * 输出缓冲来自 FramePool（SwDecodeOptions 的 pool_size / pool_exhaust），holder 释放后归还复用，dma-heap 分配时 fd 有效。
+     * 给定 Scheduler 时每路一个读包线程（阻塞读包、断线重连），包经有界队列交给共享工作线程上的解码任务（每步一个包），
+     * 否则读包和解码在同一个独占工作线程。
+     * fast_start 时用最小探测打开并缓存参数，reconnect_max_ms > 0 时实时流断线后按带抖动的指数退避重连，
+     * 分辨率和编码不变则保留解码器上下文；time_to_first_frame_ms() 给出打开/重连到出第一帧的耗时。
+     * 每次打开（连接+探测）限时 OPEN_TIMEOUT_MS，重连的打开在读包线程上，不占共享工作线程。
+     * stats() 给出读包/解码/转换/回调耗时分布、帧率、码率、队列丢弃、重连、首帧耗时和各状态停留时间。
+     * queue_policy 为 Latest 时 read() 只拿最新帧（无锁邮箱，单读者），未读的旧帧立即归还缓冲池。
+     * 与 rkmpp 后端一样需要显式 release()，运行中的工作线程/任务会保持对象存活。
+     */
+    class SwFfmDecoderImpl : public Decoder, public StatsProvider,
+                             public std::enable_shared_from_this<SwFfmDecoderImpl> {
+    public:
+        SwFfmDecoderImpl(StreamInfo info, const DecodeConfig &config, const SwDecodeOptions &options = {},
+                         std::weak_ptr<Scheduler> scheduler = {})
+                : info_(std::move(info)), config_(config), options_(options),
+                  output_(config.worker_mode, config.max_queue_size, &stats_, options.queue_policy),
+                  pool_(FramePool::create(options, config.max_queue_size)), scheduler_(std::move(scheduler)) {}
+
+        ~SwFfmDecoderImpl() override { release(); }
+
+        SwFfmDecoderImpl(const SwFfmDecoderImpl &) = delete;
+
+        SwFfmDecoderImpl &operator=(const SwFfmDecoderImpl &) = delete;
+
+        std::string id() override { return info_.stream_id; }
+
+        bool open() override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const CodecState state = state_.load();
+            if (state == CodecState::Running) return true;
+            if (state == CodecState::Released || is_released()) return false;
+            if (worker_.joinable()) worker_.join(); // 上一轮已停止（文件结束或出错），可重新打开
+
+            set_state(CodecState::Opening);
+            running_ = true;
+            connect_start_ = std::chrono::steady_clock::now();
+            first_frame_pending_ = true;
+            backoff_ms_ = RECONNECT_MIN_MS;
+            const auto scheduler = scheduler_.lock();
+            scheduled_ = scheduler != nullptr;
+            live_ = info_.uri.compare(0, 7, "rtsp://") == 0 || info_.uri.compare(0, 7, "rtmp://") == 0;
+            packet_ = av_packet_alloc();
+            frame_ = av_frame_alloc();
+            if (packet_ == nullptr || frame_ == nullptr || !open_input()) {
+                finish(false);
+                set_state(CodecState::Error);
+                return false;
+            }
+            set_state(CodecState::Running);
+            // 工作线程/任务持有自身引用，在回调里 release() 并丢掉最后一个引用也安全
+            if (scheduled_) {
+                task_id_ = scheduler->add(std::make_shared<DecodeTask>(shared_from_this()), options_.priority);
+                // 任务存活期间 finish() 会先 join 读包线程，这里不用再持有引用
+                demux_ = std::thread([this] { demux_loop(); });
+            } else {
+                worker_ = std::thread([this, self = weak_from_this().lock()] { run(); });
+            }
+            return true;
+        }
+
+        bool read(std::shared_ptr<FrameX> &framex, const int timeout_ms) override {
+            return output_.read(framex, timeout_ms);
+        }
+
+        int subscribe(Callback cb) override { return output_.subscribe(std::move(cb)); }
+
+        void unsubscribe(const int id) override { output_.unsubscribe(id); }
+
+        CodecState state() override { return state_.load(); }
+
+        [[nodiscard]] StreamInfo stream_info() const override { return info_; }
+
+        [[nodiscard]] DecodeConfig decode_config() const override { return config_; }
+
+        [[nodiscard]] SwDecodeOptions decode_options() const { return options_; }
+
+        /// 送入解码器的包数，与 num_discarded() 一起衡量 decimate 省下的解码量
+        [[nodiscard]] uint64_t num_decoded() const { return num_decoded_.load(std::memory_order_relaxed); }
+
+        /// 按 decimate 在解码前丢弃的包数
+        [[nodiscard]] uint64_t num_discarded() const { return num_discarded_.load(std::memory_order_relaxed); }
+
+        /// 最近一次打开或重连到输出第一帧的毫秒数，还没出帧时为 -1
+        [[nodiscard]] int64_t time_to_first_frame_ms() const { return stats_.first_frame_ms(); }
+
+        /// 重连尝试次数（含失败的）
+        [[nodiscard]] uint64_t num_reconnects() const { return stats_.num_reconnects(); }
+
+        CodecStats collect_stats() override {
+            return stats_.snapshot(info_.stream_id, state_.load(), output_.size(), output_.capacity());
+        }
+
+    protected:
+        void on_release() noexcept override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            set_state(CodecState::Stopping);
+            running_ = false;
+            if (pool_) pool_->close(); // 唤醒等待缓冲的解码线程
+            if (task_id_ > 0) {
+                // 在本任务的回调里释放时由当前这一步收尾，否则等正在跑的一步结束后在这里收尾
+                const auto scheduler = scheduler_.lock();
+                if (!scheduler || scheduler->remove(task_id_)) finish(true);
+                task_id_ = 0;
+            }
+            if (worker_.joinable()) {
+                if (worker_.get_id() == std::this_thread::get_id()) {
+                    worker_.detach(); // 在回调里释放，工作线程退出时自行清理
+                } else {
+                    worker_.join();
+                }
+            }
+            output_.close();
+            set_state(CodecState::Released);
+        }
+
+    private:
+        class DecodeTask : public SchedTask {
+        public:
+            explicit DecodeTask(std::shared_ptr<SwFfmDecoderImpl> decoder) : decoder_(std::move(decoder)) {}
+
+            TaskStep step() override { return decoder_->step(); }
+
+        private:
+            std::shared_ptr<SwFfmDecoderImpl> decoder_;
+        };
+
+        void set_state(const CodecState state) {
+            state_ = state;
+            stats_.set_state(state);
+        }
+
+        bool open_input() {
+            format_ = open_format();
+            const AVStream *stream = format_ != nullptr ? select_stream() : nullptr;
+            return stream != nullptr && open_codec(stream->codecpar, stream->time_base);
+        }
+
+        /// 连接并探测输入（会阻塞），整次限时 OPEN_TIMEOUT_MS，失败返回 nullptr
+        AVFormatContext *open_format() {
+            AVFormatContext *format = avformat_alloc_context();
+            if (format == nullptr) return nullptr;
+            format->interrupt_callback.callback = [](void *opaque) -> int {
+                const auto *self = static_cast<SwFfmDecoderImpl *>(opaque);
+                if (!self->running_.load()) return 1;
+                const int64_t deadline = self->open_deadline_.load(std::memory_order_relaxed);
+                return deadline != 0 && steady_ns() > deadline ? 1 : 0;
+            };
+            format->interrupt_callback.opaque = this;
+            open_deadline_ = steady_ns() + static_cast<int64_t>(OPEN_TIMEOUT_MS) * 1000000;
+
+            AVDictionary *options = nullptr;
+            if (info_.uri.compare(0, 7, "rtsp://") == 0) {
+                av_dict_set(&options, "rtsp_transport", "tcp", 0);
+                av_dict_set(&options, "timeout", "5000000", 0);
+            }
+            // rtmp 没有自己的超时，用通用的读写超时（微秒），断线时读包也不会一直卡住
+            if (info_.uri.compare(0, 7, "rtmp://") == 0) av_dict_set(&options, "rw_timeout", "5000000", 0);
+            if (options_.fast_start) {
+                // 只探测到能拿到参数集为止，帧率等不再分析
+                av_dict_set(&options, "probesize", "32768", 0);
+                av_dict_set(&options, "analyzeduration", "500000", 0);
+                av_dict_set(&options, "fpsprobesize", "0", 0);
+            }
+            int ret = avformat_open_input(&format, info_.uri.c_str(), nullptr, &options);
+            av_dict_free(&options);
+            if (ret >= 0) {
+                // 失败时 format 已被释放并置空
+                const bool cached = options_.fast_start && CodecParamsCache::instance().apply(info_.uri, format);
+                if (!cached) ret = avformat_find_stream_info(format, nullptr);
+                const int index = av_find_best_stream(format, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+                if (ret >= 0 && index >= 0 && options_.fast_start && !cached) {
+                    CodecParamsCache::instance().store(info_.uri, format->streams[index]->codecpar);
+                }
+                if (ret < 0) avformat_close_input(&format);
+            }
+            open_deadline_ = 0; // 之后的读包只受 running_ 控制
+            return format;
+        }
+
+        /// 在 format_ 上选视频流，没有时返回 nullptr
+        const AVStream *select_stream() {
+            stream_index_ = av_find_best_stream(format_, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+            return stream_index_ < 0 ? nullptr : format_->streams[stream_index_];
+        }
+
+        static int64_t steady_ns() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        /// 编码和分辨率与上次相同时复用解码器上下文（只清空缓存的帧），否则重建
+        bool open_codec(const AVCodecParameters *par, const AVRational time_base) {
+            if (codec_ != nullptr && codec_->codec_id == par->codec_id && codec_->width == par->width &&
+                codec_->height == par->height) {
+                avcodec_flush_buffers(codec_);
+                codec_->pkt_timebase = time_base;
+                return true;
+            }
+            avcodec_free_context(&codec_);
+
+            const AVCodec *codec = avcodec_find_decoder(par->codec_id);
+            if (codec == nullptr) return false;
+            codec_ = avcodec_alloc_context3(codec);
+            if (codec_ == nullptr || avcodec_parameters_to_context(codec_, par) < 0) return false;
+            codec_->thread_count = scheduled_ ? 1 : 0; // 共享工作线程时并行来自多路流，否则按 CPU 核数
+            codec_->thread_type = live_ ? FF_THREAD_SLICE : FF_THREAD_FRAME | FF_THREAD_SLICE;
+            if (live_) codec_->flags |= AV_CODEC_FLAG_LOW_DELAY;
+            codec_->pkt_timebase = time_base;
+            // 包级丢弃之外再让解码器跳过识别不了的非参考帧/非关键帧
+            if (options_.decimate == Decimate::NonRef) codec_->skip_frame = AVDISCARD_NONREF;
+            if (options_.decimate == Decimate::KeyOnly) codec_->skip_frame = AVDISCARD_NONKEY;
+            return avcodec_open2(codec_, codec, nullptr) >= 0;
+        }
+
+        void close_input() {
+            sws_freeContext(sws_);
+            sws_ = nullptr;
+            avcodec_free_context(&codec_);
+            avformat_close_input(&format_);
+            stream_index_ = -1;
+        }
+
+        /// 读包的一方交给解码的一项：一个视频包、重连后的新输入（要重开解码器）或输入结束
+        struct DemuxItem {
+            enum Kind { Packet, Input, End } kind{End};
+            std::shared_ptr<AVPacket> packet;
+            std::shared_ptr<AVCodecParameters> params;
+            AVRational time_base{0, 1};
+            std::chrono::steady_clock::time_point connect_start{};
+            bool ok{true}; // End 时：文件尾或 release() 为 true，出错为 false
+        };
+
+        /*
+         * 阻塞读下一个视频包。实时流断线且 reconnect_max_ms > 0 时就地断开，按带抖动的退避重连，
+         * 重连成功返回 Input；文件尾、出错或 release() 时返回 End。只在读包线程（独占线程时即工作线程）调用。
+         */
+        DemuxItem demux() {
+            DemuxItem item;
+            while (running_.load()) {
+                if (format_ == nullptr) {
+                    if (!sleep_while_running(jitter(backoff_ms_.load()))) break;
+                    stats_.add_reconnect();
+                    format_ = open_format();
+                    const AVStream *stream = format_ != nullptr ? select_stream() : nullptr;
+                    item.params.reset(avcodec_parameters_alloc(), [](AVCodecParameters *p) {
+                        avcodec_parameters_free(&p);
+                    });
+                    if (stream == nullptr || item.params == nullptr ||
+                        avcodec_parameters_copy(item.params.get(), stream->codecpar) < 0) {
+                        avformat_close_input(&format_);
+                        backoff_ms_ = std::min(backoff_ms_.load() * 2,
+                                               std::max(options_.reconnect_max_ms, RECONNECT_MIN_MS));
+                        continue;
+                    }
+                    item.kind = DemuxItem::Input;
+                    item.time_base = stream->time_base;
+                    item.connect_start = disconnected_at_;
+                    return item;
+                }
+
+                const auto start = StatsRecorder::Clock::now();
+                const int ret = av_read_frame(format_, packet_);
+                if (ret >= 0) {
+                    stats_.record_since(Stage::Demux, start);
+                    if (packet_->stream_index != stream_index_) {
+                        av_packet_unref(packet_);
+                        continue;
+                    }
+                    item.packet.reset(av_packet_alloc(), [](AVPacket *p) { av_packet_free(&p); });
+                    if (item.packet == nullptr) {
+                        av_packet_unref(packet_);
+                        item.ok = false;
+                        return item;
+                    }
+                    av_packet_move_ref(item.packet.get(), packet_);
+                    item.kind = DemuxItem::Packet;
+                    return item;
+                }
+                if (live_ && options_.reconnect_max_ms > 0 && running_.load()) {
+                    // 断线：只断开输入，解码器上下文留给重连后的 Input 复用
+                    avformat_close_input(&format_);
+                    disconnected_at_ = std::chrono::steady_clock::now();
+                    continue;
+                }
+                item.ok = ret == AVERROR_EOF;
+                return item;
+            }
+            return item;
+        }
+
+        /// 解码一项并输出，结束（文件尾、出错或 release）时收尾并返回 false
+        bool consume(const DemuxItem &item) {
+            bool ok = true;
+            bool done = false;
+            if (item.kind == DemuxItem::Packet) {
+                AVPacket *packet = item.packet.get();
+                stats_.add_input(static_cast<size_t>(packet->size));
+                const auto send_start = StatsRecorder::Clock::now();
+                if (!discard_packet(packet) && avcodec_send_packet(codec_, packet) >= 0) {
+                    ok = receive_frames(frame_, send_start);
+                    done = !ok;
+                }
+            } else if (item.kind == DemuxItem::Input) {
+                connect_start_ = item.connect_start;
+                first_frame_pending_ = true;
+                ok = open_codec(item.params.get(), item.time_base);
+                done = !ok;
+            } else {
+                // 文件尾冲出解码器里剩下的帧，release() 时不再输出
+                if (item.ok && running_.load()) {
+                    avcodec_send_packet(codec_, nullptr);
+                    receive_frames(frame_, StatsRecorder::Clock::now());
+                }
+                ok = item.ok;
+                done = true;
+            }
+            if (done || !running_.load()) {
+                finish(ok);
+                return false;
+            }
+            return true;
+        }
+
+        /// 独占线程：读包和解码在同一线程
+        void run() {
+            while (consume(demux())) {}
+        }
+
+        /// 跑在 Scheduler 上时的读包线程：阻塞读包和重连都在这里，包经有界队列交给解码任务
+        void demux_loop() {
+            while (true) {
+                DemuxItem item = demux();
+                const bool end = item.kind == DemuxItem::End;
+                bool was_empty;
+                {
+                    std::unique_lock<std::mutex> lock(packets_mutex_);
+                    packets_cv_.wait(lock, [this] { return packets_.size() < DEMUX_QUEUE_SIZE || !running_.load(); });
+                    if (!running_.load()) return;
+                    was_empty = packets_.empty();
+                    packets_.push_back(std::move(item));
+                }
+                // 队列非空时任务还会继续取，只在由空变非空时叫醒
+                if (was_empty) {
+                    if (const auto scheduler = scheduler_.lock()) scheduler->wake(task_id_.load());
+                }
+                if (end) return;
+            }
+        }
+
+        /// 跑在 Scheduler 上的一步：从读包队列取一项解码、输出，队列空时等读包线程 wake()
+        TaskStep step() {
+            if (!running_.load()) {
+                finish(true);
+                return {TaskState::Done};
+            }
+            DemuxItem item;
+            bool more;
+            {
+                std::lock_guard<std::mutex> lock(packets_mutex_);
+                if (packets_.empty()) return {TaskState::Wait, -1};
+                item = std::move(packets_.front());
+                packets_.pop_front();
+                more = !packets_.empty();
+            }
+            packets_cv_.notify_one();
+            if (!consume(item)) return {TaskState::Done};
+            return more ? TaskStep{TaskState::Ready} : TaskStep{TaskState::Wait, -1};
+        }
+
+        /// 分段睡眠，release() 时提前返回 false
+        bool sleep_while_running(const int ms) {
+            const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+            while (running_.load()) {
+                const auto now = std::chrono::steady_clock::now();
+                if (now >= until) return true;
+                std::this_thread::sleep_for(
+                        std::min<std::chrono::steady_clock::duration>(until - now, std::chrono::milliseconds(50)));
+            }
+            return false;
+        }
+
+        /// 退避时间取 [ms/2, ms]，避免大量摄像头同时掉线后同一时刻一起重连
+        int jitter(const int ms) {
+            return ms / 2 + static_cast<int>(random_() % static_cast<unsigned>(ms / 2 + 1));
+        }
+
+        /// 停掉读包线程并释放解码资源，可重复调用，不会在读包线程上调用
+        void finish(const bool ok) {
+            const bool stopped = running_.exchange(false);
+            {
+                // 持锁再通知，读包线程不会错过 running_ 的变化
+                std::lock_guard<std::mutex> lock(packets_mutex_);
+            }
+            packets_cv_.notify_all();
+            if (demux_.joinable()) demux_.join();
+            packets_.clear();
+            av_frame_free(&frame_);
+            av_packet_free(&packet_);
+            close_input();
+            // release() 期间由 on_release 设置最终状态
+            if (stopped) set_state(ok ? CodecState::Stopped : CodecState::Error);
+        }
+
+        /// 取出所有已解码的帧并输出，start 起到取完的解码耗时（不含输出）记一次 Codec
+        bool receive_frames(AVFrame *frame, StatsRecorder::Clock::time_point start) {
+            auto elapsed = StatsRecorder::Clock::duration::zero();
+            while (true) {
+                const int ret = avcodec_receive_frame(codec_, frame);
+                elapsed += StatsRecorder::Clock::now() - start;
+                if (ret < 0) {
+                    stats_.record(Stage::Codec, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+                    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF;
+                }
+                if (skip_frame()) {
+                    stats_.add_discarded();
+                } else {
+                    deliver(frame);
+                }
+                av_frame_unref(frame);
+                start = StatsRecorder::Clock::now();
+            }
+        }
+
+        /// 按 decimate 在送解码器之前丢包
+        bool discard_packet(const AVPacket *packet) {
+            bool discard = false;
+            if (options_.decimate == Decimate::KeyOnly) discard = (packet->flags & AV_PKT_FLAG_KEY) == 0;
+            if (options_.decimate == Decimate::NonRef) discard = is_nonref_packet(packet, codec_->codec_id);
+            (discard ? num_discarded_ : num_decoded_).fetch_add(1, std::memory_order_relaxed);
+            if (discard) stats_.add_discarded();
+            return discard;
+        }
+
+        /// 按 max_fps 限帧，在转换前丢弃以节省 CPU
+        bool skip_frame() {
+            if (config_.max_fps <= 0) return false;
+            const auto now = std::chrono::steady_clock::now();
+            const auto interval = std::chrono::microseconds(900000 / config_.max_fps);
+            if (last_output_.time_since_epoch().count() != 0 && now - last_output_ < interval) return true;
+            last_output_ = now;
+            return false;
+        }
+
+        void deliver(const AVFrame *frame) {
+            const int w = config_.width > 0 ? config_.width : frame->width;
+            const int h = config_.height > 0 ? config_.height : frame->height;
+            const ImageFormat fmt = config_.output_format;
+            const size_t size = image_size(fmt, w, h);
+            if (size == 0) return;
+
+            sws_ = sws_getCachedContext(
+                    sws_, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                    w, h, image_format_to_avfmt(fmt), SWS_BILINEAR, nullptr, nullptr, nullptr
+            );
+            if (sws_ == nullptr) return;
+
+            const std::shared_ptr<PoolBuffer> buffer = acquire_buffer(size);
+            uint8_t *data[4];
+            int linesize[4];
+            if (!buffer || !fill_image_planes(static_cast<uint8_t *>(buffer->ptr), fmt, w, h, data, linesize)) return;
+            const auto start = StatsRecorder::Clock::now();
+            sws_scale(sws_, frame->data, frame->linesize, 0, frame->height, data, linesize);
+            buffer->sync_cpu_to_device();
+            stats_.record_since(Stage::Convert, start);
+
+            const int64_t ts = frame->best_effort_timestamp;
+            const int64_t pts = ts == AV_NOPTS_VALUE ? 0 : av_rescale_q(ts, codec_->pkt_timebase, AVRational{1, 1000});
+            if (first_frame_pending_) {
+                first_frame_pending_ = false;
+                backoff_ms_ = RECONNECT_MIN_MS;
+                const auto elapsed = std::chrono::steady_clock::now() - connect_start_;
+                stats_.set_first_frame_ms(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+            }
+            stats_.add_output(size);
+            output_.publish(std::make_shared<FrameX>(
+                    info_.stream_id, w, h, fmt, buffer->fd, buffer->ptr, pts, system_time_ms(), buffer
+            ));
+        }
+
+        /// 池中取缓冲，Wait 模式分段等待以便 release() 能及时打断；未配置池时每帧分配
+        std::shared_ptr<PoolBuffer> acquire_buffer(const size_t size) {
+            if (!pool_) {
+                auto buffer = std::make_shared<PoolBuffer>();
+                buffer->memory = std::shared_ptr<void>(av_malloc(size), [](void *p) { av_free(p); });
+                buffer->ptr = buffer->memory.get();
+                buffer->size = size;
+                return buffer->ptr == nullptr ? nullptr : buffer;
+            }
+            while (running_.load()) {
+                auto buffer = pool_->acquire(size, 100);
+                if (buffer || options_.pool_exhaust != PoolExhaust::Wait) return buffer;
+            }
+            return nullptr;
+        }
+
+    private:
+        StreamInfo info_;
+        DecodeConfig config_;
+        SwDecodeOptions options_;
+        StatsRecorder stats_;
+        SwOutput<FrameX> output_;
+        std::shared_ptr<FramePool> pool_;
+        std::weak_ptr<Scheduler> scheduler_;
+
+        std::mutex mutex_;
+        std::thread worker_;
+        bool scheduled_{false};
+        std::atomic<int> task_id_{0};
+        std::atomic<bool> running_{false};
+        std::atomic<CodecState> state_{CodecState::Init};
+
+        bool live_{false};
+        int stream_index_{-1};
+        AVFormatContext *format_{nullptr};
+        AVCodecContext *codec_{nullptr};
+        SwsContext *sws_{nullptr};
+        AVPacket *packet_{nullptr};
+        AVFrame *frame_{nullptr};
+        std::chrono::steady_clock::time_point last_output_{};
+        std::atomic<uint64_t> num_decoded_{0};
+        std::atomic<uint64_t> num_discarded_{0};
+
+        static constexpr int OPEN_TIMEOUT_MS = 10000;
+        std::atomic<int64_t> open_deadline_{0}; // steady_ns()，0 表示不限时
+
+        static constexpr size_t DEMUX_QUEUE_SIZE = 32;
+        std::thread demux_; // 仅跑在 Scheduler 上时有
+        std::mutex packets_mutex_;
+        std::condition_variable packets_cv_;
+        std::deque<DemuxItem> packets_;
+
+        static constexpr int RECONNECT_MIN_MS = 250;
+        std::atomic<int> backoff_ms_{RECONNECT_MIN_MS}; // 读包线程退避，出第一帧时解码一方复位
+        std::chrono::steady_clock::time_point disconnected_at_{}; // 仅读包一方访问
+        std::minstd_rand random_{std::random_device{}()};
+        bool first_frame_pending_{false}; // 仅解码一方访问
+        std::chrono::steady_clock::time_point connect_start_{};
+    };
+
+    /*
+     * libavcodec 软编码器（H264/H265，优先 libx264/libx265 的 veryfast + zerolatency），无 B 帧，
+     * 输出 Annex-B 码流，关键帧自带参数集。EncodedX 直接引用 AVPacket 的数据，pts/timestamp 取自输入帧。
+     * stats() 里 Codec 为编码耗时，输入为写入的帧（字节数按图像大小计），输出为码流。
+     */
+    class SwFfmEncoderImpl : public Encoder, public StatsProvider,
+                             public std::enable_shared_from_this<SwFfmEncoderImpl> {
+    public:
+        SwFfmEncoderImpl(std::string id, const EncodeConfig &config, const SwEncodeOptions &options = {})
+                : id_(std::move(id)), config_(config), options_(options),
+                  output_(config.worker_mode, config.max_queue_size, &stats_) {}
+
+        ~SwFfmEncoderImpl() override { release(); }
+
+        SwFfmEncoderImpl(const SwFfmEncoderImpl &) = delete;
+
+        SwFfmEncoderImpl &operator=(const SwFfmEncoderImpl &) = delete;
+
+        std::string id() override { return id_; }
+
+        bool open() override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const CodecState state = state_.load();
+            if (state == CodecState::Running) return true;
+            if (state == CodecState::Released || is_released()) return false;
+            if (worker_.joinable()) worker_.join();
+
+            set_state(CodecState::Opening);
+            if (!open_codec()) {
+                avcodec_free_context(&codec_);
+                set_state(CodecState::Error);
+                return false;
+            }
+            running_ = true;
+            set_state(CodecState::Running);
+            worker_ = std::thread([this, self = weak_from_this().lock()] { run(); });
+            return true;
+        }
+
+        /// 输入队列满时最多等待 timeout_ms
+        bool write(const std::shared_ptr<FrameX> &item, const int timeout_ms) override {
+            if (!item || item->ptr == nullptr || state_.load() != CodecState::Running) return false;
+            std::unique_lock<std::mutex> lock(input_mutex_);
+            const size_t capacity = static_cast<size_t>(std::max(config_.max_queue_size, 1));
+            if (!input_cv_.wait_for(lock, std::chrono::milliseconds(std::max(timeout_ms, 0)), [this, capacity] {
+                return input_.size() < capacity || !running_.load();
+            }) || !running_.load()) {
+                stats_.add_discarded();
+                return false;
+            }
+            stats_.add_input(image_size(item->format, item->width, item->height));
+            input_.push_back(item);
+            lock.unlock();
+            input_cv_.notify_all();
+            return true;
+        }
+
+        bool read(std::shared_ptr<EncodedX> &encoded, const int timeout_ms) override {
+            return output_.read(encoded, timeout_ms);
+        }
+
+        int subscribe(Callback cb) override { return output_.subscribe(std::move(cb)); }
+
+        void unsubscribe(const int id) override { output_.unsubscribe(id); }
+
+        CodecState state() override { return state_.load(); }
+
+        [[nodiscard]] EncodeConfig encode_config() const override { return config_; }
+
+        [[nodiscard]] SwEncodeOptions encode_options() const { return options_; }
+
+        CodecStats collect_stats() override {
+            return stats_.snapshot(id_, state_.load(), output_.size(), output_.capacity());
+        }
+
+    protected:
+        void on_release() noexcept override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            set_state(CodecState::Stopping);
+            {
+                std::lock_guard<std::mutex> input_lock(input_mutex_);
+                running_ = false;
+                input_.clear();
+            }
+            input_cv_.notify_all();
+            if (worker_.joinable()) {
+                if (worker_.get_id() == std::this_thread::get_id()) {
+                    worker_.detach();
+                } else {
+                    worker_.join();
+                }
+            } else {
+                avcodec_free_context(&codec_);
+            }
+            output_.close();
+            set_state(CodecState::Released);
+        }
+
+    private:
+        struct Pending {
+            int64_t index;
+            int64_t pts;
+            uint32_t timestamp;
+            std::string stream_id;
+        };
+
+        void set_state(const CodecState state) {
+            state_ = state;
+            stats_.set_state(state);
+        }
+
+        bool open_codec() {
+            const bool h264 = config_.codec_type == CodecType::H264;
+            const AVCodec *codec = avcodec_find_encoder_by_name(h264 ? "libx264" : "libx265");
+            if (codec == nullptr) codec = avcodec_find_encoder(h264 ? AV_CODEC_ID_H264 : AV_CODEC_ID_HEVC);
+            if (codec == nullptr || config_.width <= 0 || config_.height <= 0) return false;
+
+            codec_ = avcodec_alloc_context3(codec);
+            if (codec_ == nullptr) return false;
+            const int fps = config_.max_fps > 0 ? config_.max_fps : 30;
+            codec_->width = config_.width;
+            codec_->height = config_.height;
+            codec_->time_base = AVRational{1, fps};
+            codec_->framerate = AVRational{fps, 1};
+            codec_->gop_size = fps * 2;
+            codec_->max_b_frames = 0;
+            codec_->thread_count = 0;
+            if (options_.bitrate_kbps > 0) {
+                // 按目标码率限速，VBV 缓冲 1 秒
+                codec_->bit_rate = static_cast<int64_t>(options_.bitrate_kbps) * 1000;
+                codec_->rc_max_rate = codec_->bit_rate;
+                codec_->rc_buffer_size = static_cast<int>(codec_->bit_rate);
+            }
+            codec_->pix_fmt = AV_PIX_FMT_YUV420P;
+            if (codec->pix_fmts != nullptr) {
+                codec_->pix_fmt = codec->pix_fmts[0];
+                for (const AVPixelFormat *p = codec->pix_fmts; *p != AV_PIX_FMT_NONE; ++p) {
+                    if (*p == AV_PIX_FMT_YUV420P) codec_->pix_fmt = *p;
+                }
+            }
+            // 非 libx264/libx265 的编码器没有这些选项，忽略失败
+            av_opt_set(codec_->priv_data, "preset", "veryfast", 0);
+            av_opt_set(codec_->priv_data, "tune", "zerolatency", 0);
+            return avcodec_open2(codec_, codec, nullptr) >= 0;
+        }
+
+        void run() {
+            AVFrame *frame = av_frame_alloc();
+            AVPacket *packet = av_packet_alloc();
+            bool ok = frame != nullptr && packet != nullptr;
+            if (ok) {
+                frame->format = codec_->pix_fmt;
+                frame->width = codec_->width;
+                frame->height = codec_->height;
+                ok = av_frame_get_buffer(frame, 0) >= 0;
+            }
+
+            while (ok) {
+                std::shared_ptr<FrameX> item;
+                {
+                    std::unique_lock<std::mutex> lock(input_mutex_);
+                    input_cv_.wait(lock, [this] { return !input_.empty() || !running_.load(); });
+                    if (!running_.load()) break;
+                    item = std::move(input_.front());
+                    input_.pop_front();
+                }
+                input_cv_.notify_all();
+                ok = encode(*item, frame, packet);
+            }
+
+            av_packet_free(&packet);
+            av_frame_free(&frame);
+            avcodec_free_context(&codec_);
+            sws_freeContext(sws_);
+            sws_ = nullptr;
+            if (running_.exchange(false)) set_state(ok ? CodecState::Stopped : CodecState::Error);
+        }
+
+        bool encode(const FrameX &item, AVFrame *frame, AVPacket *packet) {
+            uint8_t *data[4];
+            int linesize[4];
+            if (!fill_image_planes(static_cast<uint8_t *>(item.ptr), item.format, item.width, item.height, data,
+                                   linesize)) {
+                return true; // 不支持的输入格式，丢弃该帧
+            }
+            sws_ = sws_getCachedContext(
+                    sws_, item.width, item.height, image_format_to_avfmt(item.format),
+                    codec_->width, codec_->height, codec_->pix_fmt, SWS_BILINEAR, nullptr, nullptr, nullptr
+            );
+            if (sws_ == nullptr || av_frame_make_writable(frame) < 0) return false;
+            auto start = StatsRecorder::Clock::now();
+            sws_scale(sws_, data, linesize, 0, item.height, frame->data, frame->linesize);
+            stats_.record_since(Stage::Convert, start);
+
+            frame->pts = next_index_;
+            pending_.push_back(Pending{next_index_++, item.pts, item.timestamp, item.stream_id});
+            start = StatsRecorder::Clock::now();
+            if (avcodec_send_frame(codec_, frame) < 0) return false;
+
+            // 编码耗时不含输出回调
+            auto elapsed = StatsRecorder::Clock::duration::zero();
+            while (true) {
+                const int ret = avcodec_receive_packet(codec_, packet);
+                elapsed += StatsRecorder::Clock::now() - start;
+                if (ret < 0) {
+                    stats_.record(Stage::Codec, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+                    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF;
+                }
+                deliver(packet);
+                start = StatsRecorder::Clock::now();
+            }
+        }
+
+        void deliver(AVPacket *packet) {
+            // 无 B 帧，输出顺序与输入一致
+            while (pending_.size() > 1 && pending_.front().index < packet->pts) pending_.pop_front();
+            Pending meta = pending_.empty() ? Pending{packet->pts, 0, 0, id_} : pending_.front();
+            if (!pending_.empty() && pending_.front().index == packet->pts) pending_.pop_front();
+
+            std::shared_ptr<AVPacket> holder(av_packet_clone(packet), [](AVPacket *p) { av_packet_free(&p); });
+            av_packet_unref(packet);
+            if (!holder) return;
+            stats_.add_output(static_cast<size_t>(holder->size));
+            output_.publish(std::make_shared<EncodedX>(
+                    meta.stream_id.empty() ? id_ : meta.stream_id, holder->data, static_cast<size_t>(holder->size),
+                    (holder->flags & AV_PKT_FLAG_KEY) != 0, meta.pts, meta.timestamp, holder
+            ));
+        }
+
+    private:
+        std::string id_;
+        EncodeConfig config_;
+        SwEncodeOptions options_;
+        StatsRecorder stats_;
+        SwOutput<EncodedX> output_;
+
+        std::mutex mutex_;
+        std::thread worker_;
+        std::atomic<bool> running_{false};
+        std::atomic<CodecState> state_{CodecState::Init};
+
+        std::mutex input_mutex_;
+        std::condition_variable input_cv_;
+        std::deque<std::shared_ptr<FrameX> > input_;
+
+        AVCodecContext *codec_{nullptr};
+        SwsContext *sws_{nullptr};
+        int64_t next_index_{0};
+        std::deque<Pending> pending_;
+    };
+
+    /*
+     * 软件后端的 Manager，接口行为与 rkmpp 后端一致。
+     * 解码器默认作为任务跑在共享、按核绑定的 Scheduler 上（线程数 = CPU 核数），num_workers < 0 时每路一个线程；
+     * 默认构造时从环境变量 VCODECX_WORKERS 读取。
+     * 软件后端才有的选项（缓冲池、优先级、降帧、重连等）通过带 SwDecodeOptions / SwEncodeOptions 的重载传入。
+     */
+    class SwFfmManagerImpl : public Manager {
+    public:
+        explicit SwFfmManagerImpl(const int num_workers = workers_from_env()) {
+            if (num_workers >= 0) scheduler_ = std::make_shared<Scheduler>(num_workers);
+        }
+
+        std::shared_ptr<Decoder> create_decoder(const StreamInfo &info, const DecodeConfig &config) override {
+            return create_decoder(info, config, SwDecodeOptions{});
+        }
+
+        /// stream_id 已存在时返回已有的解码器，options 不生效
+        std::shared_ptr<Decoder> create_decoder(const StreamInfo &info, const DecodeConfig &config,
+                                                const SwDecodeOptions &options) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto &decoder = decoders_[info.stream_id];
+            if (!decoder) decoder = std::make_shared<SwFfmDecoderImpl>(info, config, options, scheduler_);
+            return decoder;
+        }
+
+        /// 共享调度器，每路一个线程时为空
+        [[nodiscard]] std::shared_ptr<Scheduler> scheduler() const { return scheduler_; }
+
+        CodecState get_decoder_state(const std::string &stream_id) override {
+            const auto decoder = get_decoder(stream_id);
+            return decoder ? decoder->state() : CodecState::Released;
+        }
+
+        std::shared_ptr<Decoder> get_decoder(const std::string &stream_id) override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto it = decoders_.find(stream_id);
+            return it == decoders_.end() ? nullptr : it->second;
+        }
+
+        std::unordered_map<std::string, std::shared_ptr<Decoder> > get_all_decoders() override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return decoders_;
+        }
+
+        int subscribe_decoder(const std::string &stream_id, Decoder::Callback cb) override {
+            const auto decoder = get_decoder(stream_id);
+            return decoder ? decoder->subscribe(std::move(cb)) : -1;
+        }
+
+        void unsubscribe_decoder(const std::string &stream_id, const int subscribe_id) override {
+            if (const auto decoder = get_decoder(stream_id)) decoder->unsubscribe(subscribe_id);
+        }
+
+        bool start_decoder(const std::string &stream_id) override {
+            const auto decoder = get_decoder(stream_id);
+            return decoder && decoder->open();
+        }
+
+        bool release_decoder(const std::string &stream_id) override {
+            std::shared_ptr<Decoder> decoder;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                const auto it = decoders_.find(stream_id);
+                if (it == decoders_.end()) return false;
+                decoder = std::move(it->second);
+                decoders_.erase(it);
+            }
+            decoder->release();
+            return true;
+        }
+
+        std::shared_ptr<Encoder> create_encoder(const EncodeConfig &config) override {
+            return create_encoder(config, SwEncodeOptions{});
+        }
+
+        std::shared_ptr<Encoder> create_encoder(const EncodeConfig &config, const SwEncodeOptions &options) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const std::string id = "sw_encoder_" + std::to_string(++last_encoder_id_);
+            auto encoder = std::make_shared<SwFfmEncoderImpl>(id, config, options);
+            encoders_[id] = encoder;
+            return encoder;
+        }
+
+        CodecState get_encoder_state(const std::string &id) override {
+            const auto encoder = get_encoder(id);
+            return encoder ? encoder->state() : CodecState::Released;
+        }
+
+        std::shared_ptr<Encoder> get_encoder(const std::string &id) override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const auto it = encoders_.find(id);
+            return it == encoders_.end() ? nullptr : it->second;
+        }
+
+        std::unordered_map<std::string, std::shared_ptr<Encoder> > get_all_encoders() override {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return encoders_;
+        }
+
+        int subscribe_encoder(const std::string &id, Encoder::Callback cb) override {
+            const auto encoder = get_encoder(id);
+            return encoder ? encoder->subscribe(std::move(cb)) : -1;
+        }
+
+        void unsubscribe_encoder(const std::string &id, const int subscribe_id) override {
+            if (const auto encoder = get_encoder(id)) encoder->unsubscribe(subscribe_id);
+        }
+
+        bool start_encoder(const std::string &id) override {
+            const auto encoder = get_encoder(id);
+            return encoder && encoder->open();
+        }
+
+        bool release_encoder(const std::string &key) override {
+            std::shared_ptr<Encoder> encoder;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                const auto it = encoders_.find(key);
+                if (it == encoders_.end()) return false;
+                encoder = std::move(it->second);
+                encoders_.erase(it);
+            }
+            encoder->release();
+            return true;
+        }
+
+    private:
+        static int workers_from_env() {
+            const char *env = std::getenv("VCODECX_WORKERS");
+            return env == nullptr ? 0 : std::atoi(env);
+        }
+
+    private:
+        std::shared_ptr<Scheduler> scheduler_;
+        std::mutex mutex_;
+        std::unordered_map<std::string, std::shared_ptr<Decoder> > decoders_;
+        std::unordered_map<std::string, std::shared_ptr<Encoder> > encoders_;
+        int last_encoder_id_{0};
+    };
+#endif
+
+    inline std::shared_ptr<Manager> Manager::create(const Backend backend) {
+        if (backend == Backend::Default) {
+            const char *env = std::getenv("VCODECX_BACKEND");
+            const bool software = env != nullptr && std::strcmp(env, "software") == 0;
+            return create(software || !VCODECX_HAS_RKMPP ? Backend::Software : Backend::Rkmpp);
+        }
+#if VCODECX_HAS_RKMPP
+        if (backend == Backend::Rkmpp) return create();
+#endif
+#if VCODECX_HAS_SOFTWARE
+        if (backend == Backend::Software) return std::make_shared<SwFfmManagerImpl>();
+#endif
+        return nullptr;
+    }
+
+#if !VCODECX_HAS_RKMPP
+    /// 没有 librkffmpeg 的平台上默认使用软件后端
+    inline std::shared_ptr<Manager> Manager::create() { return create(Backend::Software); }
+#endif
+}
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "vcodecx/types.h"
+
+namespace vcodecx {
+    /*
+     * 无锁延迟直方图：按 2 的幂分段，每段再线性分 8 格（约 12% 精度），范围 1us 到数小时。
+     * record_us() 只有 relaxed 原子操作，可以放在解码热路径上，由统计线程读取。
+     */
+    class LatencyHistogram {
+    public:
+        LatencyHistogram() { reset(); }
+
+        LatencyHistogram(const LatencyHistogram &) = delete;
+
+        LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+        void record_us(int64_t us) {
+            if (us < 0) us = 0;
+            buckets_[bucket(static_cast<uint64_t>(us))].fetch_add(1, std::memory_order_relaxed);
+            count_.fetch_add(1, std::memory_order_relaxed);
+            sum_us_.fetch_add(static_cast<uint64_t>(us), std::memory_order_relaxed);
+            uint64_t max = max_us_.load(std::memory_order_relaxed);
+            while (static_cast<uint64_t>(us) > max &&
+                   !max_us_.compare_exchange_weak(max, static_cast<uint64_t>(us), std::memory_order_relaxed)) {}
+        }
+
+        [[nodiscard]] uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] uint64_t sum_us() const { return sum_us_.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] uint64_t max_us() const { return max_us_.load(std::memory_order_relaxed); }
+
+        [[nodiscard]] uint64_t mean_us() const {
+            const uint64_t n = count();
+            return n == 0 ? 0 : sum_us() / n;
+        }
+
+        /// 给定百分位（0..100）所在格的上界
+        [[nodiscard]] uint64_t percentile_us(const double percentile) const {
+            const uint64_t n = count();
+            if (n == 0) return 0;
+            auto rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(n) + 0.5);
+            if (rank < 1) rank = 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+                seen += buckets_[i].load(std::memory_order_relaxed);
+                if (seen >= rank) return std::min(upper_bound(i), max_us());
+            }
+            return max_us();
+        }
+
+        void reset() {
+            for (auto &b: buckets_) b.store(0, std::memory_order_relaxed);
+            count_.store(0, std::memory_order_relaxed);
+            sum_us_.store(0, std::memory_order_relaxed);
+            max_us_.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        static constexpr size_t SUB_BITS = 3;
+        static constexpr size_t SUB_BUCKETS = 1u << SUB_BITS;
+        static constexpr size_t NUM_RANGES = 32;
+        static constexpr size_t NUM_BUCKETS = NUM_RANGES * SUB_BUCKETS;
+
+        static size_t bucket(const uint64_t us) {
+            if (us < SUB_BUCKETS) return static_cast<size_t>(us);
+            const size_t msb = 63u - static_cast<size_t>(__builtin_clzll(us));
+            const size_t range = msb - SUB_BITS + 1;
+            if (range >= NUM_RANGES) return NUM_BUCKETS - 1;
+            const auto sub = static_cast<size_t>((us >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+            return range * SUB_BUCKETS + sub;
+        }
+
+        static uint64_t upper_bound(const size_t index) {
+            const size_t range = index / SUB_BUCKETS;
+            const size_t sub = index % SUB_BUCKETS;
+            if (range == 0) return sub;
+            return ((SUB_BUCKETS + sub + 1) << (range - 1)) - 1;
+        }
+
+    private:
+        std::atomic<uint64_t> buckets_[NUM_BUCKETS];
+        std::atomic<uint64_t> count_{0};
+        std::atomic<uint64_t> sum_us_{0};
+        std::atomic<uint64_t> max_us_{0};
+    };
+
+    /// 直方图快照，单位微秒
+    struct LatencyStats {
+        uint64_t count{0};
+        uint64_t mean_us{0};
+        uint64_t p50_us{0};
+        uint64_t p90_us{0};
+        uint64_t p99_us{0};
+        uint64_t max_us{0};
+    };
+
+    enum class Stage {
+        Demux, // 读包（av_read_frame / 拉流），含网络等待
+        Codec, // 解码器送包+取帧，编码器里为送帧+取包
+        Convert, // 缩放/格式转换
+        Callback // Callback 模式下订阅者回调
+    };
+
+    static constexpr size_t NUM_CODEC_STATES = static_cast<size_t>(CodecState::Released) + 1;
+
+    /*
+     * 单个编解码器的统计快照。计数和延迟分布从创建起累计；fps、码率、busy 按最近 1~2 秒计算。
+     * available 为 false 时后端不提供统计（rkmpp），只有 id 和 state 有效。
+     */
+    struct CodecStats {
+        std::string id{};
+        CodecState state{CodecState::Init};
+        bool available{false};
+
+        uint64_t frames_in{0}; // 解码器为本路视频包数，编码器为写入的帧数
+        uint64_t frames_out{0};
+        uint64_t bytes_in{0};
+        uint64_t bytes_out{0};
+        double input_fps{0};
+        double output_fps{0};
+        double input_bitrate_bps{0};
+        double output_bitrate_bps{0};
+        double busy{0}; // 每秒花在 Codec + Convert 上的秒数，约等于占用的核数，过载时按它挑选要限流的流
+
+        uint64_t discarded{0}; // 主动丢弃：decimate、max_fps 限帧，编码器为输入队列满写入失败
+        int queue_size{0}; // QueueRead 输出队列当前长度
+        int queue_capacity{0};
+        uint64_t queue_dropped{0}; // QueueRead 队列满丢掉的最旧项
+        uint64_t reconnects{0};
+        int64_t first_frame_ms{-1}; // 最近一次打开/重连到出第一帧的耗时（毫秒），-1 为尚未出帧
+
+        LatencyStats demux{};
+        LatencyStats codec{};
+        LatencyStats convert{};
+        LatencyStats callback{};
+
+        std::array<double, NUM_CODEC_STATES> state_seconds{}; // 按 CodecState 下标，各状态累计停留秒数
+    };
+
+    /// Manager 下所有编解码器的快照和合计
+    struct ManagerStats {
+        std::vector<CodecStats> decoders{};
+        std::vector<CodecStats> encoders{};
+        double decode_fps{0}; // 各解码器 output_fps 之和
+        double encode_fps{0}; // 各编码器 output_fps 之和
+        double input_bitrate_bps{0}; // 各解码器输入码率之和
+        double output_bitrate_bps{0}; // 各编码器输出码率之和
+        double busy{0};
+        uint64_t queue_dropped{0};
+        uint64_t reconnects{0};
+        int64_t max_first_frame_ms{-1}; // 各解码器 first_frame_ms 的最大值，整批重连后最慢一路的出帧耗时
+        int num_running{0};
+        int num_error{0};
+    };
+
+    /*
+     * 编解码器内部的统计计数：热路径上只有 relaxed 原子操作；状态切换和 snapshot() 加锁（都不在热路径上）。
+     * 线程安全。
+     */
+    class StatsRecorder {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        StatsRecorder() : state_since_(Clock::now()) {
+            samples_[0].time = samples_[1].time = state_since_;
+        }
+
+        StatsRecorder(const StatsRecorder &) = delete;
+
+        StatsRecorder &operator=(const StatsRecorder &) = delete;
+
+        void add_input(const size_t bytes) {
+            frames_in_.fetch_add(1, std::memory_order_relaxed);
+            bytes_in_.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        void add_output(const size_t bytes) {
+            frames_out_.fetch_add(1, std::memory_order_relaxed);
+            bytes_out_.fetch_add(bytes, std::memory_order_relaxed);
+        }
+
+        void add_discarded() { discarded_.fetch_add(1, std::memory_order_relaxed); }
+
+        void add_queue_dropped() { queue_dropped_.fetch_add(1, std::memory_order_relaxed); }
+
+        void add_reconnect() { reconnects_.fetch_add(1, std::memory_order_relaxed); }
+
+        void set_first_frame_ms(const int64_t ms) { first_frame_ms_.store(ms, std::memory_order_relaxed); }
+
+        [[nodiscard]] int64_t first_frame_ms() const { return first_frame_ms_.load(std::memory_order_relaxed); }
+
+        void record(const Stage stage, const int64_t us) { histograms_[static_cast<size_t>(stage)].record_us(us); }
+
+        /// 记录从 start 到现在的耗时
+        void record_since(const Stage stage, const Clock::time_point start) {
+            record(stage, std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+        }
+
+        void set_state(const CodecState state) {
+            const auto now = Clock::now();
+            std::lock_guard<std::mutex> lock(mutex_);
+            state_time_[static_cast<size_t>(state_)] += now - state_since_;
+            state_ = state;
+            state_since_ = now;
+        }
+
+        [[nodiscard]] uint64_t num_reconnects() const { return reconnects_.load(std::memory_order_relaxed); }
+
+        /// 生成快照，队列长度由调用方给出
+        CodecStats snapshot(std::string id, const CodecState state, const int queue_size, const int queue_capacity) {
+            CodecStats stats;
+            stats.id = std::move(id);
+            stats.state = state;
+            stats.available = true;
+            stats.frames_in = frames_in_.load(std::memory_order_relaxed);
+            stats.frames_out = frames_out_.load(std::memory_order_relaxed);
+            stats.bytes_in = bytes_in_.load(std::memory_order_relaxed);
+            stats.bytes_out = bytes_out_.load(std::memory_order_relaxed);
+            stats.discarded = discarded_.load(std::memory_order_relaxed);
+            stats.queue_size = queue_size;
+            stats.queue_capacity = queue_capacity;
+            stats.queue_dropped = queue_dropped_.load(std::memory_order_relaxed);
+            stats.reconnects = reconnects_.load(std::memory_order_relaxed);
+            stats.first_frame_ms = first_frame_ms_.load(std::memory_order_relaxed);
+            stats.demux = latency(Stage::Demux);
+            stats.codec = latency(Stage::Codec);
+            stats.convert = latency(Stage::Convert);
+            stats.callback = latency(Stage::Callback);
+
+            Sample current;
+            current.time = Clock::now();
+            current.frames_in = stats.frames_in;
+            current.frames_out = stats.frames_out;
+            current.bytes_in = stats.bytes_in;
+            current.bytes_out = stats.bytes_out;
+            current.busy_us = histograms_[static_cast<size_t>(Stage::Codec)].sum_us() +
+                              histograms_[static_cast<size_t>(Stage::Convert)].sum_us();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (size_t i = 0; i < NUM_CODEC_STATES; ++i) {
+                auto time = state_time_[i];
+                if (i == static_cast<size_t>(state_)) time += current.time - state_since_;
+                stats.state_seconds[i] = std::chrono::duration<double>(time).count();
+            }
+
+            // 速率取最近一个不短于 RATE_WINDOW 的区间：samples_[1] 够旧就用它并前移，否则用更早的 samples_[0]，
+            // 多个调用方以不同频率轮询时窗口也不会变得过短
+            const bool shift = current.time - samples_[1].time >= RATE_WINDOW;
+            const Sample &base = shift ? samples_[1] : samples_[0];
+            const double seconds = std::chrono::duration<double>(current.time - base.time).count();
+            if (seconds > 0) {
+                stats.input_fps = static_cast<double>(current.frames_in - base.frames_in) / seconds;
+                stats.output_fps = static_cast<double>(current.frames_out - base.frames_out) / seconds;
+                stats.input_bitrate_bps = static_cast<double>(current.bytes_in - base.bytes_in) * 8 / seconds;
+                stats.output_bitrate_bps = static_cast<double>(current.bytes_out - base.bytes_out) * 8 / seconds;
+                stats.busy = static_cast<double>(current.busy_us - base.busy_us) / 1e6 / seconds;
+            }
+            if (shift) {
+                samples_[0] = samples_[1];
+                samples_[1] = current;
+            }
+            return stats;
+        }
+
+    private:
+        struct Sample {
+            Clock::time_point time{};
+            uint64_t frames_in{0};
+            uint64_t frames_out{0};
+            uint64_t bytes_in{0};
+            uint64_t bytes_out{0};
+            uint64_t busy_us{0};
+        };
+
+        static constexpr std::chrono::seconds RATE_WINDOW{1};
+
+        [[nodiscard]] LatencyStats latency(const Stage stage) const {
+            const LatencyHistogram &histogram = histograms_[static_cast<size_t>(stage)];
+            LatencyStats stats;
+            stats.count = histogram.count();
+            stats.mean_us = histogram.mean_us();
+            stats.p50_us = histogram.percentile_us(50);
+            stats.p90_us = histogram.percentile_us(90);
+            stats.p99_us = histogram.percentile_us(99);
+            stats.max_us = histogram.max_us();
+            return stats;
+        }
+
+    private:
+        std::atomic<uint64_t> frames_in_{0};
+        std::atomic<uint64_t> frames_out_{0};
+        std::atomic<uint64_t> bytes_in_{0};
+        std::atomic<uint64_t> bytes_out_{0};
+        std::atomic<uint64_t> discarded_{0};
+        std::atomic<uint64_t> queue_dropped_{0};
+        std::atomic<uint64_t> reconnects_{0};
+        std::atomic<int64_t> first_frame_ms_{-1};
+        LatencyHistogram histograms_[4];
+
+        std::mutex mutex_;
+        CodecState state_{CodecState::Init};
+        Clock::time_point state_since_;
+        std::array<Clock::duration, NUM_CODEC_STATES> state_time_{};
+        Sample samples_[2];
+    };
+
+    /// 提供统计的后端实现（软件后端）额外继承该接口，Decoder/Encoder::stats() 经 dynamic_cast 取用
+    class StatsProvider {
+    public:
+        virtual ~StatsProvider() = default;
+
+        virtual CodecStats collect_stats() = 0;
+    };
+}
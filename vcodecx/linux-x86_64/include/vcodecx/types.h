@@ -0,0 +1,198 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+#include <iostream>
+
+namespace vcodecx {
+    enum class WorkerMode {
+        Callback, // 订阅回调模式（消息到来时立即推送）
+        QueueRead // 队列轮询读取模式（消费者主动从队列取）
+    };
+
+    enum class QueuePolicy {
+        Fifo, // 有界先进先出，满时丢最旧（录像等需要连续帧的场景）
+        Latest // 只保留最新一帧，无锁三缓冲 + futex 等待（分析/推理只要最新帧）
+    };
+
+    enum class MediaType { File, Camera, RTSP };
+
+    /// 省下的解码量随码流结构而定（IPPP 摄像头流几乎没有非参考帧），以 stats() 的 busy 与 discarded 实测为准
+    enum class Decimate {
+        None, // 全部解码，只按 max_fps 丢弃输出
+        NonRef, // 解码前丢弃非参考帧（包级识别 + AVDISCARD_NONREF），不影响其余帧
+        KeyOnly // 只解码关键帧，适合只要抽帧的分析
+    };
+
+    enum class PoolExhaust {
+        Grow, // 池已空时临时分配一块池外缓冲，用完即释放
+        Wait, // 等待下游归还缓冲（解码线程阻塞）
+        Drop // 丢弃当前帧
+    };
+
+    enum class CodecType { H264, H265, HEVC };
+
+    enum class ImageFormat {
+        RGB24, // RGB 888
+        BGR24, // BGR 888
+        RGBA32, // RGBA 8888
+        BGRA32, // BGRA 8888
+        NV12, // Y plane + interleaved UV
+        NV21, // Y plane + interleaved VU
+        I420, // YUV420P: Y + U + V
+        YV12, // Y + V + U
+        YUYV422, // Packed 4:2:2 YUYV
+        UYVY422 // Packed 4:2:2 UYVY
+    };
+
+    enum class CodecState {
+        Init, // 刚创建
+        Opening, // 正在初始化资源/上下文
+        Running, // 正在处理媒体（编码/解码）
+        Stopping, // 正在停止线程、关闭 IO
+        Stopped, // 停止完成，但可重新开启
+        Error, // 错误状态，可尝试重启，也可直接 release
+        Released // 完全释放，不可再用
+    };
+
+    struct FrameX {
+        std::string stream_id{};
+        int width{};
+        int height{};
+        ImageFormat format{};
+        int64_t pts{};
+        uint32_t timestamp{};
+        int fd{-1};
+        void *ptr{nullptr};
+        std::shared_ptr<void> holder{};
+
+        FrameX() = default;
+
+        FrameX(const FrameX &) = delete;
+
+        FrameX &operator=(const FrameX &) = delete;
+
+        FrameX(FrameX &&) = default;
+
+        FrameX &operator=(FrameX &&) = default;
+
+        FrameX(
+                std::string stream_id, const int w, const int h, const ImageFormat format, const int fd, void *ptr,
+                const int64_t pts, const uint32_t ts, std::shared_ptr<void> holder
+        ) : stream_id(std::move(stream_id)), width(w), height(h), format(format), fd(fd), ptr(ptr), pts(pts),
+            timestamp(ts), holder(std::move(holder)) {
+        }
+    };
+
+    struct EncodedX {
+        std::string stream_id{};
+        size_t size{};
+        int64_t pts{};
+        bool is_audio{};      // 是否是音频包
+        bool is_keyframe{};
+        uint32_t timestamp{};
+        uint8_t *data{nullptr};
+        std::shared_ptr<void> holder;
+
+        EncodedX() = default;
+
+        EncodedX(const EncodedX &) = delete;
+
+        EncodedX &operator=(const EncodedX &) = delete;
+
+        EncodedX(EncodedX &&) = default;
+
+        EncodedX &operator=(EncodedX &&) = default;
+
+        EncodedX(
+                std::string stream_id, uint8_t *data, const size_t size, bool is_keyframe, const int64_t pts,
+                const uint32_t ts, std::shared_ptr<void> holder, bool is_audio = false
+        ) : stream_id(std::move(stream_id)), size(size), pts(pts), is_keyframe(is_keyframe), is_audio(is_audio),
+            timestamp(ts), data(data), holder(std::move(holder)) {
+        }
+    };
+
+    struct StreamInfo {
+        std::string uri{};
+        std::string name{};
+        std::string stream_id{};
+
+        StreamInfo() = default;
+
+        explicit StreamInfo(std::string id, std::string uri, std::string name = {})
+                : stream_id(std::move(id)), uri(std::move(uri)), name(std::move(name)) {
+        }
+    };
+
+    struct DecodeConfig {
+        int width;
+        int height;
+        int max_fps;
+        int max_queue_size;
+        WorkerMode worker_mode;
+        ImageFormat output_format;
+
+        DecodeConfig() = default;
+
+        explicit DecodeConfig(
+                const int w, const int h, const ImageFormat fmt = ImageFormat::BGR24,
+                const WorkerMode mode = WorkerMode::QueueRead, const int fps = 60, const int cap = 5
+        ) : width(w), height(h), output_format(fmt), worker_mode(mode), max_fps(fps), max_queue_size(cap) {
+        }
+    };
+
+    struct EncodeConfig {
+        int width;
+        int height;
+        int max_fps;
+        int max_queue_size;
+        CodecType codec_type;
+        WorkerMode worker_mode;
+
+        EncodeConfig() = default;
+
+        explicit EncodeConfig(
+                const int w, const int h, const WorkerMode mode = WorkerMode::QueueRead,
+                const int fps = 30, const int queue_size = 5, const CodecType codec_type = CodecType::H265
+        ) : width(w), height(h), worker_mode(mode), max_fps(fps), max_queue_size(queue_size), codec_type(codec_type) {
+        }
+    };
+
+    /*
+     * 软件后端（vcodecx/soft.h）才有的解码选项。DecodeConfig / EncodeConfig 与预编译的 librkffmpeg 共用，
+     * 布局不能改，新选项都放在这里，通过 SwFfmManagerImpl::create_decoder 的重载传入，rkmpp 后端不支持。
+     */
+    struct SwDecodeOptions {
+        int pool_size{0}; // 输出缓冲池大小，0 为 max_queue_size + 3，负数不使用池（每帧分配）
+        PoolExhaust pool_exhaust{PoolExhaust::Grow}; // 池中缓冲全部被下游持有时的行为
+        int priority{0}; // 共享工作线程池上的调度优先级，每加 1 份额翻倍（-3..3）
+        Decimate decimate{Decimate::None}; // 解码前的降帧方式
+        bool fast_start{false}; // 最小探测打开，按 uri 缓存编码参数，重连时跳过完整探测
+        int reconnect_max_ms{0}; // 实时流断线后自动重连的最大退避（毫秒），0 不重连
+        QueuePolicy queue_policy{QueuePolicy::Fifo}; // QueueRead 模式下输出队列的策略
+    };
+
+    /// 软件后端才有的编码选项，见 SwDecodeOptions
+    struct SwEncodeOptions {
+        int bitrate_kbps{0}; // 目标码率（kbps），0 为编码器默认
+    };
+
+    // ===========================================================
+    //                      枚举类型转换
+    // ===========================================================
+    std::string worker_mode_to_string(WorkerMode mode);
+
+    bool worker_mode_from_string(std::string &str, WorkerMode &mode);
+
+    std::string media_type_to_string(MediaType type);
+
+    bool media_type_from_string(std::string &str, MediaType &type);
+
+    std::string codec_type_to_string(CodecType type);
+
+    bool codec_type_from_string(std::string &str, CodecType &type);
+
+    std::string image_format_to_string(ImageFormat fmt);
+
+    bool image_format_from_string(std::string &str, ImageFormat &fmt);
+}